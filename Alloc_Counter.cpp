@@ -0,0 +1,24 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// replaces the global allocation functions of the test app, so tests can check the steady-state frame path
+// allocates nothing. linked into app only, every other target keeps the default allocator
+std::atomic<unsigned long> g_num_allocations(0);
+
+void* operator new(std::size_t size)
+{
+    g_num_allocations++;
+    if(void* ptr = std::malloc(size > 0 ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
@@ -0,0 +1,1098 @@
+#include "Argmax_Simd.hpp"
+#include "Tools.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define ARGMAX_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*argmax_tensor_fn)(const int8_t*, int8_t* const, const unsigned int, const unsigned int);
+
+typedef void (*argmax_top2_fn)(const int8_t*, int8_t* const, int8_t* const, uint8_t* const, const unsigned int, const unsigned int);
+
+typedef void (*argmax_quantized_fn)(const int8_t*, int8_t* const, const int32_t*, const int32_t*, const unsigned int, const unsigned int);
+
+typedef void (*bilinear_argmax_row_fn)(
+    const int8_t*, const int8_t*, const unsigned int, int8_t* const,
+    const unsigned int, const unsigned int, const unsigned int, const unsigned int*, const uint8_t*);
+
+static void argmax_tensor_scalar(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    argmax_tensor(tensor_ptr, mat_ptr, num_filters, mat_size);
+}
+
+static void argmax_top2_scalar(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    int8_t* const value_ptr,
+    uint8_t* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    argmax_top2_tensor(tensor_ptr, mat_ptr, value_ptr, margin_ptr, num_filters, mat_size);
+}
+
+static void argmax_quantized_scalar(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    argmax_quantized_tensor(tensor_ptr, mat_ptr, multiplier, offset, num_filters, mat_size);
+}
+
+static void argmax_planar_scalar(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    argmax_planar(tensor_ptr, mat_ptr, num_filters, mat_size);
+}
+
+static void bilinear_argmax_row_scalar(
+    const int8_t* row0_ptr,
+    const int8_t* row1_ptr,
+    const unsigned int row_weight,
+    int8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* column_index,
+    const uint8_t* column_weight)
+{
+    bilinear_argmax_row<int8_t, int8_t>(row0_ptr, row1_ptr, row_weight, mat_row_ptr, num_filters, num_columns, scaled_up_num_columns, column_index, column_weight);
+}
+
+// planar argmax for the pixels [start, mat_size) left over after the vector blocks
+static void argmax_planar_tail(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const unsigned int start)
+{
+    for (unsigned int i = start; i < mat_size; i++)
+    {
+        int8_t max_val = tensor_ptr[i];
+        int8_t max_index = 0;
+        for (unsigned int f = 1; f < num_filters; f++)
+        {
+            const int8_t val = tensor_ptr[(size_t)f * mat_size + i];
+            if (val > max_val)
+            {
+                max_val = val;
+                max_index = (int8_t)f;
+            }
+        }
+        mat_ptr[i] = max_index;
+    }
+}
+
+#if ARGMAX_SIMD_X86 == 1
+
+// every lane ends up holding the max of the 16 lanes
+__attribute__((target("sse4.1")))
+static inline __m128i hmax_epi8_sse41(__m128i v)
+{
+    v = _mm_max_epi8(v, _mm_alignr_epi8(v, v, 8));
+    v = _mm_max_epi8(v, _mm_alignr_epi8(v, v, 4));
+    v = _mm_max_epi8(v, _mm_alignr_epi8(v, v, 2));
+    v = _mm_max_epi8(v, _mm_alignr_epi8(v, v, 1));
+    return v;
+}
+
+// cells narrower than a vector are loaded whole and the lanes past num_filters are forced to INT8_MIN,
+// they sit after every real lane so they can never win the first-index search.
+// cells wider than a vector are walked in full chunks plus one overlapping chunk ending at num_filters.
+// the last cells of the tensor, where a full vector load would read past the end, use the scalar argmax.
+
+__attribute__((target("sse4.1")))
+static void argmax_tensor_sse41(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int width = 16;
+    const size_t tensor_size = (size_t)num_filters * mat_size;
+    if (num_filters == 0) return argmax_tensor(tensor_ptr, mat_ptr, num_filters, mat_size);
+    unsigned int safe_cells = tensor_size < width ? 0 : (unsigned int)((tensor_size - width) / num_filters + 1);
+    if (safe_cells > mat_size) safe_cells = mat_size;
+
+    if (num_filters < width)
+    {
+        alignas(16) int8_t lane_mask[width];
+        for (unsigned int i = 0; i < width; i++) lane_mask[i] = i < num_filters ? -1 : 0;
+        const __m128i keep = _mm_load_si128((const __m128i*)lane_mask);
+        const __m128i fill = _mm_set1_epi8(INT8_MIN);
+        for (unsigned int i = 0; i < safe_cells; i++)
+        {
+            const __m128i v = _mm_blendv_epi8(fill, _mm_loadu_si128((const __m128i*)tensor_ptr), keep);
+            const unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, hmax_epi8_sse41(v)));
+            mat_ptr[i] = (int8_t)__builtin_ctz(mask);
+            tensor_ptr += num_filters;
+        }
+    }
+    else
+    {
+        const unsigned int tail = num_filters - width;
+        for (unsigned int i = 0; i < safe_cells; i++)
+        {
+            __m128i vmax = _mm_loadu_si128((const __m128i*)(tensor_ptr + tail));
+            for (unsigned int f = 0; f < tail; f += width)
+            {
+                vmax = _mm_max_epi8(vmax, _mm_loadu_si128((const __m128i*)(tensor_ptr + f)));
+            }
+            vmax = hmax_epi8_sse41(vmax);
+
+            unsigned int index = tail;
+            unsigned int mask = 0;
+            for (unsigned int f = 0; f < tail && mask == 0; f += width)
+            {
+                mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(tensor_ptr + f)), vmax));
+                index = f;
+            }
+            if (mask == 0)
+            {
+                mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(tensor_ptr + tail)), vmax));
+                index = tail;
+            }
+            mat_ptr[i] = (int8_t)(index + __builtin_ctz(mask));
+            tensor_ptr += num_filters;
+        }
+    }
+    argmax_tensor(tensor_ptr, mat_ptr + safe_cells, num_filters, mat_size - safe_cells);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i hmax_epi8_avx2(const __m256i v)
+{
+    __m128i m = _mm_max_epi8(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    m = _mm_max_epi8(m, _mm_alignr_epi8(m, m, 8));
+    m = _mm_max_epi8(m, _mm_alignr_epi8(m, m, 4));
+    m = _mm_max_epi8(m, _mm_alignr_epi8(m, m, 2));
+    m = _mm_max_epi8(m, _mm_alignr_epi8(m, m, 1));
+    return _mm256_broadcastsi128_si256(m);
+}
+
+__attribute__((target("avx2,bmi")))
+static void argmax_tensor_avx2(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int width = 32;
+    const size_t tensor_size = (size_t)num_filters * mat_size;
+    if (num_filters == 0) return argmax_tensor(tensor_ptr, mat_ptr, num_filters, mat_size);
+    unsigned int safe_cells = tensor_size < width ? 0 : (unsigned int)((tensor_size - width) / num_filters + 1);
+    if (safe_cells > mat_size) safe_cells = mat_size;
+
+    if (num_filters < width)
+    {
+        alignas(32) int8_t lane_mask[width];
+        for (unsigned int i = 0; i < width; i++) lane_mask[i] = i < num_filters ? -1 : 0;
+        const __m256i keep = _mm256_load_si256((const __m256i*)lane_mask);
+        const __m256i fill = _mm256_set1_epi8(INT8_MIN);
+        for (unsigned int i = 0; i < safe_cells; i++)
+        {
+            const __m256i v = _mm256_blendv_epi8(fill, _mm256_loadu_si256((const __m256i*)tensor_ptr), keep);
+            const unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, hmax_epi8_avx2(v)));
+            mat_ptr[i] = (int8_t)_tzcnt_u32(mask);
+            tensor_ptr += num_filters;
+        }
+    }
+    else
+    {
+        const unsigned int tail = num_filters - width;
+        for (unsigned int i = 0; i < safe_cells; i++)
+        {
+            __m256i vmax = _mm256_loadu_si256((const __m256i*)(tensor_ptr + tail));
+            for (unsigned int f = 0; f < tail; f += width)
+            {
+                vmax = _mm256_max_epi8(vmax, _mm256_loadu_si256((const __m256i*)(tensor_ptr + f)));
+            }
+            vmax = hmax_epi8_avx2(vmax);
+
+            unsigned int index = tail;
+            unsigned int mask = 0;
+            for (unsigned int f = 0; f < tail && mask == 0; f += width)
+            {
+                mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(tensor_ptr + f)), vmax));
+                index = f;
+            }
+            if (mask == 0)
+            {
+                mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(tensor_ptr + tail)), vmax));
+                index = tail;
+            }
+            mat_ptr[i] = (int8_t)(index + _tzcnt_u32(mask));
+            tensor_ptr += num_filters;
+        }
+    }
+    argmax_tensor(tensor_ptr, mat_ptr + safe_cells, num_filters, mat_size - safe_cells);
+}
+
+__attribute__((target("avx512f,avx512bw,bmi")))
+static inline __m512i hmax_epi8_avx512bw(const __m512i v)
+{
+    const __m256i h = _mm256_max_epi8(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v, 1));
+    __m128i m = _mm_max_epi8(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+    m = _mm_max_epi8(m, _mm_alignr_epi8(m, m, 8));
+    m = _mm_max_epi8(m, _mm_alignr_epi8(m, m, 4));
+    m = _mm_max_epi8(m, _mm_alignr_epi8(m, m, 2));
+    m = _mm_max_epi8(m, _mm_alignr_epi8(m, m, 1));
+    return _mm512_broadcastb_epi8(m);
+}
+
+// masked loads never fault on the suppressed lanes, so every cell takes the vector path
+__attribute__((target("avx512f,avx512bw,bmi")))
+static void argmax_tensor_avx512bw(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int width = 64;
+    const unsigned int num_chunks = (num_filters + width - 1) / width;
+    const unsigned int last_chunk = (num_chunks - 1) * width;
+    const unsigned int last_width = num_filters - last_chunk;
+    const __mmask64 last_keep = last_width == width ? ~(__mmask64)0 : (((__mmask64)1 << last_width) - 1);
+    const __m512i fill = _mm512_set1_epi8(INT8_MIN);
+
+    if (num_filters == 0) return argmax_tensor(tensor_ptr, mat_ptr, num_filters, mat_size);
+    for (unsigned int i = 0; i < mat_size; i++)
+    {
+        __m512i vmax = _mm512_mask_loadu_epi8(fill, last_keep, tensor_ptr + last_chunk);
+        for (unsigned int f = 0; f < last_chunk; f += width)
+        {
+            vmax = _mm512_max_epi8(vmax, _mm512_loadu_si512((const void*)(tensor_ptr + f)));
+        }
+        vmax = hmax_epi8_avx512bw(vmax);
+
+        unsigned int index = last_chunk;
+        __mmask64 mask = 0;
+        for (unsigned int f = 0; f < last_chunk && mask == 0; f += width)
+        {
+            mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*)(tensor_ptr + f)), vmax);
+            index = f;
+        }
+        if (mask == 0)
+        {
+            mask = _mm512_mask_cmpeq_epi8_mask(last_keep, _mm512_maskz_loadu_epi8(last_keep, tensor_ptr + last_chunk), vmax);
+            index = last_chunk;
+        }
+        mat_ptr[i] = (int8_t)(index + (unsigned int)_tzcnt_u64(mask));
+        tensor_ptr += num_filters;
+    }
+}
+
+// top-2 kernels : a cell that fits in one vector is loaded whole as in argmax_tensor, the max gives the winning lane,
+// which is then forced to INT8_MIN so a second horizontal max gives the runner-up. a tied lane stays in, so a tie
+// has a margin of 0. cells wider than one vector use the scalar top-2, the class counts we run fit in a vector.
+
+__attribute__((target("sse4.1")))
+static void argmax_top2_sse41(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    int8_t* const value_ptr,
+    uint8_t* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int width = 16;
+    const size_t tensor_size = (size_t)num_filters * mat_size;
+    if (num_filters == 0 || num_filters > width) return argmax_top2_tensor(tensor_ptr, mat_ptr, value_ptr, margin_ptr, num_filters, mat_size);
+    unsigned int safe_cells = tensor_size < width ? 0 : (unsigned int)((tensor_size - width) / num_filters + 1);
+    if (safe_cells > mat_size) safe_cells = mat_size;
+
+    alignas(16) int8_t lane_mask[width];
+    for (unsigned int i = 0; i < width; i++) lane_mask[i] = i < num_filters ? -1 : 0;
+    const __m128i keep = _mm_load_si128((const __m128i*)lane_mask);
+    const __m128i fill = _mm_set1_epi8(INT8_MIN);
+    const __m128i lanes = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    for (unsigned int i = 0; i < safe_cells; i++)
+    {
+        const __m128i v = _mm_blendv_epi8(fill, _mm_loadu_si128((const __m128i*)tensor_ptr), keep);
+        const __m128i vmax = hmax_epi8_sse41(v);
+        const unsigned int index = (unsigned int)__builtin_ctz((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vmax)));
+        const __m128i rest = _mm_blendv_epi8(v, fill, _mm_cmpeq_epi8(lanes, _mm_set1_epi8((char)index)));
+        const int8_t max_val = (int8_t)_mm_cvtsi128_si32(vmax);
+        const int8_t runner_up_val = num_filters > 1 ? (int8_t)_mm_cvtsi128_si32(hmax_epi8_sse41(rest)) : max_val;
+        mat_ptr[i] = (int8_t)index;
+        if (value_ptr) value_ptr[i] = max_val;
+        if (margin_ptr) margin_ptr[i] = (uint8_t)(max_val - runner_up_val);
+        tensor_ptr += num_filters;
+    }
+    argmax_top2_tensor(
+        tensor_ptr, mat_ptr + safe_cells, value_ptr ? value_ptr + safe_cells : nullptr, margin_ptr ? margin_ptr + safe_cells : nullptr,
+        num_filters, mat_size - safe_cells);
+}
+
+__attribute__((target("avx2,bmi")))
+static void argmax_top2_avx2(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    int8_t* const value_ptr,
+    uint8_t* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int width = 32;
+    const size_t tensor_size = (size_t)num_filters * mat_size;
+    if (num_filters == 0 || num_filters > width) return argmax_top2_tensor(tensor_ptr, mat_ptr, value_ptr, margin_ptr, num_filters, mat_size);
+    unsigned int safe_cells = tensor_size < width ? 0 : (unsigned int)((tensor_size - width) / num_filters + 1);
+    if (safe_cells > mat_size) safe_cells = mat_size;
+
+    alignas(32) int8_t lane_mask[width];
+    for (unsigned int i = 0; i < width; i++) lane_mask[i] = i < num_filters ? -1 : 0;
+    const __m256i keep = _mm256_load_si256((const __m256i*)lane_mask);
+    const __m256i fill = _mm256_set1_epi8(INT8_MIN);
+    const __m256i lanes = _mm256_setr_epi8(
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+    for (unsigned int i = 0; i < safe_cells; i++)
+    {
+        const __m256i v = _mm256_blendv_epi8(fill, _mm256_loadu_si256((const __m256i*)tensor_ptr), keep);
+        const __m256i vmax = hmax_epi8_avx2(v);
+        const unsigned int index = _tzcnt_u32((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vmax)));
+        const __m256i rest = _mm256_blendv_epi8(v, fill, _mm256_cmpeq_epi8(lanes, _mm256_set1_epi8((char)index)));
+        const int8_t max_val = (int8_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(vmax));
+        const int8_t runner_up_val = num_filters > 1 ? (int8_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(hmax_epi8_avx2(rest))) : max_val;
+        mat_ptr[i] = (int8_t)index;
+        if (value_ptr) value_ptr[i] = max_val;
+        if (margin_ptr) margin_ptr[i] = (uint8_t)(max_val - runner_up_val);
+        tensor_ptr += num_filters;
+    }
+    argmax_top2_tensor(
+        tensor_ptr, mat_ptr + safe_cells, value_ptr ? value_ptr + safe_cells : nullptr, margin_ptr ? margin_ptr + safe_cells : nullptr,
+        num_filters, mat_size - safe_cells);
+}
+
+// masked loads never fault on the suppressed lanes, so every cell takes the vector path
+__attribute__((target("avx512f,avx512bw,bmi")))
+static void argmax_top2_avx512bw(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    int8_t* const value_ptr,
+    uint8_t* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int width = 64;
+    if (num_filters == 0 || num_filters > width) return argmax_top2_tensor(tensor_ptr, mat_ptr, value_ptr, margin_ptr, num_filters, mat_size);
+    const __mmask64 keep = num_filters == width ? ~(__mmask64)0 : (((__mmask64)1 << num_filters) - 1);
+    const __m512i fill = _mm512_set1_epi8(INT8_MIN);
+    for (unsigned int i = 0; i < mat_size; i++)
+    {
+        const __m512i v = _mm512_mask_loadu_epi8(fill, keep, tensor_ptr);
+        const __m512i vmax = hmax_epi8_avx512bw(v);
+        const unsigned int index = (unsigned int)_tzcnt_u64(_mm512_cmpeq_epi8_mask(v, vmax));
+        const __m512i rest = _mm512_mask_mov_epi8(v, (__mmask64)1 << index, fill);
+        const int8_t max_val = (int8_t)_mm_cvtsi128_si32(_mm512_castsi512_si128(vmax));
+        const int8_t runner_up_val = num_filters > 1 ? (int8_t)_mm_cvtsi128_si32(_mm512_castsi512_si128(hmax_epi8_avx512bw(rest))) : max_val;
+        mat_ptr[i] = (int8_t)index;
+        if (value_ptr) value_ptr[i] = max_val;
+        if (margin_ptr) margin_ptr[i] = (uint8_t)(max_val - runner_up_val);
+        tensor_ptr += num_filters;
+    }
+}
+
+// quantized kernels : each lane keeps the largest int32 key it has seen and the class it came from, a strictly
+// greater key replaces it so every lane holds its first max. the cell max is then the smallest class among
+// the lanes holding the overall max. the padded tables end every cell on a whole vector, so a cell reads up to
+// 7 bytes past its last class, and the last cells of the tensor, where that would read past the end, use the scalar argmax.
+
+__attribute__((target("sse4.1")))
+static inline unsigned int first_max_index_epi32_sse41(const __m128i vmax, const __m128i vindex)
+{
+    __m128i m = _mm_max_epi32(vmax, _mm_shuffle_epi32(vmax, 0x4E));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, 0xB1));
+    __m128i c = _mm_blendv_epi8(_mm_set1_epi32(INT32_MAX), vindex, _mm_cmpeq_epi32(vmax, m));
+    c = _mm_min_epi32(c, _mm_shuffle_epi32(c, 0x4E));
+    c = _mm_min_epi32(c, _mm_shuffle_epi32(c, 0xB1));
+    return (unsigned int)_mm_cvtsi128_si32(c);
+}
+
+__attribute__((target("sse4.1")))
+static void argmax_quantized_sse41(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int padded_num_filters = (num_filters + 7) & ~7u;
+    const size_t tensor_size = (size_t)num_filters * mat_size;
+    if (num_filters == 0) return argmax_quantized_tensor(tensor_ptr, mat_ptr, multiplier, offset, num_filters, mat_size);
+    unsigned int safe_cells = tensor_size < padded_num_filters ? 0 : (unsigned int)((tensor_size - padded_num_filters) / num_filters + 1);
+    if (safe_cells > mat_size) safe_cells = mat_size;
+
+    const __m128i step = _mm_set1_epi32(4);
+    for (unsigned int i = 0; i < safe_cells; i++)
+    {
+        __m128i vmax = _mm_set1_epi32(INT32_MIN);
+        __m128i vindex = _mm_setzero_si128();
+        __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+        for (unsigned int f = 0; f < padded_num_filters; f += 4)
+        {
+            int32_t bytes;
+            memcpy(&bytes, tensor_ptr + f, sizeof(bytes));
+            const __m128i q = _mm_cvtepi8_epi32(_mm_cvtsi32_si128(bytes));
+            const __m128i key = _mm_add_epi32(
+                _mm_mullo_epi32(q, _mm_loadu_si128((const __m128i*)(multiplier + f))),
+                _mm_loadu_si128((const __m128i*)(offset + f)));
+            const __m128i greater = _mm_cmpgt_epi32(key, vmax);
+            vmax = _mm_blendv_epi8(vmax, key, greater);
+            vindex = _mm_blendv_epi8(vindex, index, greater);
+            index = _mm_add_epi32(index, step);
+        }
+        mat_ptr[i] = (int8_t)first_max_index_epi32_sse41(vmax, vindex);
+        tensor_ptr += num_filters;
+    }
+    argmax_quantized_tensor(tensor_ptr, mat_ptr + safe_cells, multiplier, offset, num_filters, mat_size - safe_cells);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int first_max_index_epi32_avx2(const __m256i vmax, const __m256i vindex)
+{
+    __m128i m = _mm_max_epi32(_mm256_castsi256_si128(vmax), _mm256_extracti128_si256(vmax, 1));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, 0x4E));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, 0xB1));
+    const __m256i candidates = _mm256_blendv_epi8(_mm256_set1_epi32(INT32_MAX), vindex, _mm256_cmpeq_epi32(vmax, _mm256_broadcastd_epi32(m)));
+    __m128i c = _mm_min_epi32(_mm256_castsi256_si128(candidates), _mm256_extracti128_si256(candidates, 1));
+    c = _mm_min_epi32(c, _mm_shuffle_epi32(c, 0x4E));
+    c = _mm_min_epi32(c, _mm_shuffle_epi32(c, 0xB1));
+    return (unsigned int)_mm_cvtsi128_si32(c);
+}
+
+// also used for AVX512BW, the 21 class cells we run would leave most of a 16 lane int32 vector as padding
+__attribute__((target("avx2")))
+static void argmax_quantized_avx2(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int padded_num_filters = (num_filters + 7) & ~7u;
+    const size_t tensor_size = (size_t)num_filters * mat_size;
+    if (num_filters == 0) return argmax_quantized_tensor(tensor_ptr, mat_ptr, multiplier, offset, num_filters, mat_size);
+    unsigned int safe_cells = tensor_size < padded_num_filters ? 0 : (unsigned int)((tensor_size - padded_num_filters) / num_filters + 1);
+    if (safe_cells > mat_size) safe_cells = mat_size;
+
+    const __m256i step = _mm256_set1_epi32(8);
+    for (unsigned int i = 0; i < safe_cells; i++)
+    {
+        __m256i vmax = _mm256_set1_epi32(INT32_MIN);
+        __m256i vindex = _mm256_setzero_si256();
+        __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        for (unsigned int f = 0; f < padded_num_filters; f += 8)
+        {
+            const __m256i q = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(tensor_ptr + f)));
+            const __m256i key = _mm256_add_epi32(
+                _mm256_mullo_epi32(q, _mm256_loadu_si256((const __m256i*)(multiplier + f))),
+                _mm256_loadu_si256((const __m256i*)(offset + f)));
+            const __m256i greater = _mm256_cmpgt_epi32(key, vmax);
+            vmax = _mm256_blendv_epi8(vmax, key, greater);
+            vindex = _mm256_blendv_epi8(vindex, index, greater);
+            index = _mm256_add_epi32(index, step);
+        }
+        mat_ptr[i] = (int8_t)first_max_index_epi32_avx2(vmax, vindex);
+        tensor_ptr += num_filters;
+    }
+    argmax_quantized_tensor(tensor_ptr, mat_ptr + safe_cells, multiplier, offset, num_filters, mat_size - safe_cells);
+}
+
+// each 16 byte source block expands to scale_up_factor output vectors, output lane l of vector k
+// takes source byte (16 * k + l) / scale_up_factor, which stays inside the block when scale_up_factor divides 16
+__attribute__((target("ssse3")))
+static void broadcast_bytes_ssse3(
+    const int8_t* src_ptr,
+    int8_t* const dst_ptr,
+    const unsigned int count,
+    const unsigned int scale_up_factor)
+{
+    const unsigned int width = 16;
+    __m128i shuffles[width];
+    for (unsigned int k = 0; k < scale_up_factor; k++)
+    {
+        alignas(16) int8_t lanes[width];
+        for (unsigned int l = 0; l < width; l++) lanes[l] = (int8_t)((width * k + l) / scale_up_factor);
+        shuffles[k] = _mm_load_si128((const __m128i*)lanes);
+    }
+
+    unsigned int i = 0;
+    int8_t* dst_cptr = dst_ptr;
+    for (; i + width <= count; i += width)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(src_ptr + i));
+        for (unsigned int k = 0; k < scale_up_factor; k++)
+        {
+            _mm_storeu_si128((__m128i*)dst_cptr, _mm_shuffle_epi8(v, shuffles[k]));
+            dst_cptr += width;
+        }
+    }
+    if (i < count)
+    {
+        // the tail goes through a padded copy so nothing is read or written past the row
+        alignas(16) int8_t src_tail[width] = {};
+        alignas(16) int8_t dst_tail[width * width];
+        memcpy(src_tail, src_ptr + i, count - i);
+        const __m128i v = _mm_load_si128((const __m128i*)src_tail);
+        for (unsigned int k = 0; k < scale_up_factor; k++)
+        {
+            _mm_store_si128((__m128i*)(dst_tail + width * k), _mm_shuffle_epi8(v, shuffles[k]));
+        }
+        memcpy(dst_cptr, dst_tail, (count - i) * scale_up_factor);
+    }
+}
+
+__attribute__((target("ssse3")))
+static void gather_bytes_ssse3(
+    const int8_t* src_ptr,
+    const unsigned int src_count,
+    int8_t* const dst_ptr,
+    const unsigned int dst_count,
+    const unsigned int* column_index,
+    const int8_t* column_shuffle)
+{
+    const unsigned int width = 16;
+    unsigned int c = 0;
+    // a block loads the 16 source bytes starting at its first column, blocks that would read past the row are scalar
+    for (; c + width <= dst_count && column_index[c] + width <= src_count; c += width)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(src_ptr + column_index[c]));
+        const __m128i shuffle = _mm_loadu_si128((const __m128i*)(column_shuffle + c));
+        _mm_storeu_si128((__m128i*)(dst_ptr + c), _mm_shuffle_epi8(v, shuffle));
+    }
+    for (; c < dst_count; c++) dst_ptr[c] = src_ptr[column_index[c]];
+}
+
+// the two source rows are blended once into an int16 row (Q4), every output pixel then blends two of its
+// pixels (Q8, still inside int16) and finds the max with phminposuw on the values flipped by x ^ 0x7fff,
+// which turns the signed max into an unsigned min and keeps the first lane on ties
+__attribute__((target("sse4.1")))
+static void bilinear_argmax_row_sse41(
+    const int8_t* row0_ptr,
+    const int8_t* row1_ptr,
+    const unsigned int row_weight,
+    int8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* column_index,
+    const uint8_t* column_weight)
+{
+    const unsigned int width = 8;
+    if (num_filters == 0 || num_filters > 256)
+    {
+        bilinear_argmax_row_scalar(row0_ptr, row1_ptr, row_weight, mat_row_ptr, num_filters, num_columns, scaled_up_num_columns, column_index, column_weight);
+        return;
+    }
+
+    // one blended row per thread, the slack lets the last pixel be read with full vectors
+    thread_local std::vector<int16_t> blended_row;
+    const unsigned int row_size = num_columns * num_filters;
+    if (blended_row.size() < row_size + width) blended_row.resize(row_size + width);
+    int16_t* const blended_ptr = blended_row.data();
+
+    const __m128i row_weight_0 = _mm_set1_epi16((int16_t)(16 - row_weight));
+    const __m128i row_weight_1 = _mm_set1_epi16((int16_t)row_weight);
+    unsigned int i = 0;
+    for (; i + width <= row_size; i += width)
+    {
+        const __m128i a = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)(row0_ptr + i)));
+        const __m128i b = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)(row1_ptr + i)));
+        _mm_storeu_si128((__m128i*)(blended_ptr + i), _mm_add_epi16(_mm_mullo_epi16(a, row_weight_0), _mm_mullo_epi16(b, row_weight_1)));
+    }
+    for (; i < row_size; i++) blended_ptr[i] = (int16_t)((16 - row_weight) * row0_ptr[i] + row_weight * row1_ptr[i]);
+    for (; i < row_size + width; i++) blended_ptr[i] = 0;
+
+    // lanes past num_filters in the last vector are forced to the largest flipped value
+    const unsigned int num_vectors = (num_filters + width - 1) / width;
+    const unsigned int last_lanes = num_filters - (num_vectors - 1) * width;
+    alignas(16) int16_t pad_lanes[width];
+    for (unsigned int l = 0; l < width; l++) pad_lanes[l] = (int16_t)(l < last_lanes ? 0 : -1);
+    const __m128i pad = _mm_load_si128((const __m128i*)pad_lanes);
+    const __m128i flip = _mm_set1_epi16(0x7fff);
+
+    for (unsigned int c = 0; c < scaled_up_num_columns; c++)
+    {
+        const int16_t* const pixel_0 = blended_ptr + column_index[c] * num_filters;
+        const int16_t* const pixel_1 = pixel_0 + (column_weight[c] > 0 ? num_filters : 0);
+        const __m128i column_weight_0 = _mm_set1_epi16((int16_t)(16 - column_weight[c]));
+        const __m128i column_weight_1 = _mm_set1_epi16((int16_t)column_weight[c]);
+        unsigned int best_value = 0x10000;
+        unsigned int best_index = 0;
+        for (unsigned int k = 0; k < num_vectors; k++)
+        {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(pixel_0 + k * width));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(pixel_1 + k * width));
+            __m128i flipped = _mm_xor_si128(_mm_add_epi16(_mm_mullo_epi16(a, column_weight_0), _mm_mullo_epi16(b, column_weight_1)), flip);
+            if (k + 1 == num_vectors) flipped = _mm_or_si128(flipped, pad);
+            const __m128i min_pos = _mm_minpos_epu16(flipped);
+            const unsigned int value = (unsigned int)_mm_extract_epi16(min_pos, 0);
+            if (value < best_value)
+            {
+                best_value = value;
+                best_index = k * width + (unsigned int)_mm_extract_epi16(min_pos, 1);
+            }
+        }
+        mat_row_ptr[c] = (int8_t)best_index;
+    }
+}
+
+// planar kernels keep a block of pixel maxima and their plane indices in registers and walk down the planes,
+// a strictly greater compare keeps the first plane on ties
+
+__attribute__((target("sse4.1")))
+static void argmax_planar_sse41(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int width = 16;
+    unsigned int i = 0;
+    for (; i + width <= mat_size && num_filters > 0; i += width)
+    {
+        __m128i vmax = _mm_loadu_si128((const __m128i*)(tensor_ptr + i));
+        __m128i vindex = _mm_setzero_si128();
+        for (unsigned int f = 1; f < num_filters; f++)
+        {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(tensor_ptr + (size_t)f * mat_size + i));
+            const __m128i greater = _mm_cmpgt_epi8(v, vmax);
+            vmax = _mm_max_epi8(vmax, v);
+            vindex = _mm_blendv_epi8(vindex, _mm_set1_epi8((char)f), greater);
+        }
+        _mm_storeu_si128((__m128i*)(mat_ptr + i), vindex);
+    }
+    argmax_planar_tail(tensor_ptr, mat_ptr, num_filters, mat_size, i);
+}
+
+__attribute__((target("avx2")))
+static void argmax_planar_avx2(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int width = 32;
+    unsigned int i = 0;
+    for (; i + width <= mat_size && num_filters > 0; i += width)
+    {
+        __m256i vmax = _mm256_loadu_si256((const __m256i*)(tensor_ptr + i));
+        __m256i vindex = _mm256_setzero_si256();
+        for (unsigned int f = 1; f < num_filters; f++)
+        {
+            const __m256i v = _mm256_loadu_si256((const __m256i*)(tensor_ptr + (size_t)f * mat_size + i));
+            const __m256i greater = _mm256_cmpgt_epi8(v, vmax);
+            vmax = _mm256_max_epi8(vmax, v);
+            vindex = _mm256_blendv_epi8(vindex, _mm256_set1_epi8((char)f), greater);
+        }
+        _mm256_storeu_si256((__m256i*)(mat_ptr + i), vindex);
+    }
+    argmax_planar_tail(tensor_ptr, mat_ptr, num_filters, mat_size, i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void argmax_planar_avx512bw(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    const unsigned int width = 64;
+    if (num_filters == 0) return argmax_planar_tail(tensor_ptr, mat_ptr, num_filters, mat_size, 0);
+    for (unsigned int i = 0; i < mat_size; i += width)
+    {
+        const __mmask64 keep = (mat_size - i >= width) ? ~(__mmask64)0 : (((__mmask64)1 << (mat_size - i)) - 1);
+        __m512i vmax = _mm512_maskz_loadu_epi8(keep, tensor_ptr + i);
+        __m512i vindex = _mm512_setzero_si512();
+        for (unsigned int f = 1; f < num_filters; f++)
+        {
+            const __m512i v = _mm512_maskz_loadu_epi8(keep, tensor_ptr + (size_t)f * mat_size + i);
+            const __mmask64 greater = _mm512_cmpgt_epi8_mask(v, vmax);
+            vmax = _mm512_max_epi8(vmax, v);
+            vindex = _mm512_mask_mov_epi8(vindex, greater, _mm512_set1_epi8((char)f));
+        }
+        _mm512_mask_storeu_epi8(mat_ptr + i, keep, vindex);
+    }
+}
+
+#endif
+
+const char* simd_isa_name(const Simd_Isa isa)
+{
+    switch (isa)
+    {
+    case Simd_Isa::sse41: return "SSE4.1";
+    case Simd_Isa::avx2: return "AVX2";
+    case Simd_Isa::avx512bw: return "AVX512BW";
+    default: return "scalar";
+    }
+}
+
+bool simd_isa_supported(const Simd_Isa isa)
+{
+#if ARGMAX_SIMD_X86 == 1
+    __builtin_cpu_init();
+    switch (isa)
+    {
+    case Simd_Isa::sse41: return __builtin_cpu_supports("sse4.1");
+    case Simd_Isa::avx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+    case Simd_Isa::avx512bw: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("bmi");
+    default: return true;
+    }
+#else
+    return isa == Simd_Isa::scalar;
+#endif
+}
+
+Simd_Isa simd_isa_best()
+{
+    static const Simd_Isa best = []()
+    {
+        if (simd_isa_supported(Simd_Isa::avx512bw)) return Simd_Isa::avx512bw;
+        if (simd_isa_supported(Simd_Isa::avx2)) return Simd_Isa::avx2;
+        if (simd_isa_supported(Simd_Isa::sse41)) return Simd_Isa::sse41;
+        return Simd_Isa::scalar;
+    }();
+    return best;
+}
+
+static argmax_tensor_fn argmax_tensor_impl(const Simd_Isa isa)
+{
+    if (!simd_isa_supported(isa)) return argmax_tensor_scalar;
+    switch (isa)
+    {
+#if ARGMAX_SIMD_X86 == 1
+    case Simd_Isa::sse41: return argmax_tensor_sse41;
+    case Simd_Isa::avx2: return argmax_tensor_avx2;
+    case Simd_Isa::avx512bw: return argmax_tensor_avx512bw;
+#endif
+    default: return argmax_tensor_scalar;
+    }
+}
+
+void argmax_tensor_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    static const argmax_tensor_fn impl = argmax_tensor_impl(simd_isa_best());
+    impl(tensor_ptr, mat_ptr, num_filters, mat_size);
+}
+
+void argmax_tensor_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa)
+{
+    argmax_tensor_impl(isa)(tensor_ptr, mat_ptr, num_filters, mat_size);
+}
+
+static argmax_top2_fn argmax_top2_impl(const Simd_Isa isa)
+{
+    if (!simd_isa_supported(isa)) return argmax_top2_scalar;
+    switch (isa)
+    {
+#if ARGMAX_SIMD_X86 == 1
+    case Simd_Isa::sse41: return argmax_top2_sse41;
+    case Simd_Isa::avx2: return argmax_top2_avx2;
+    case Simd_Isa::avx512bw: return argmax_top2_avx512bw;
+#endif
+    default: return argmax_top2_scalar;
+    }
+}
+
+void argmax_top2_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    int8_t* const value_ptr,
+    uint8_t* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    static const argmax_top2_fn impl = argmax_top2_impl(simd_isa_best());
+    impl(tensor_ptr, mat_ptr, value_ptr, margin_ptr, num_filters, mat_size);
+}
+
+void argmax_top2_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    int8_t* const value_ptr,
+    uint8_t* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa)
+{
+    argmax_top2_impl(isa)(tensor_ptr, mat_ptr, value_ptr, margin_ptr, num_filters, mat_size);
+}
+
+static argmax_quantized_fn argmax_quantized_impl(const Simd_Isa isa)
+{
+    if (!simd_isa_supported(isa)) return argmax_quantized_scalar;
+    switch (isa)
+    {
+#if ARGMAX_SIMD_X86 == 1
+    case Simd_Isa::sse41: return argmax_quantized_sse41;
+    case Simd_Isa::avx2: return argmax_quantized_avx2;
+    case Simd_Isa::avx512bw: return argmax_quantized_avx2;
+#endif
+    default: return argmax_quantized_scalar;
+    }
+}
+
+void argmax_quantized_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    static const argmax_quantized_fn impl = argmax_quantized_impl(simd_isa_best());
+    impl(tensor_ptr, mat_ptr, multiplier, offset, num_filters, mat_size);
+}
+
+void argmax_quantized_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa)
+{
+    argmax_quantized_impl(isa)(tensor_ptr, mat_ptr, multiplier, offset, num_filters, mat_size);
+}
+
+void argmax_quantized_simd(
+    const int8_t* tensor_ptr,
+    uint8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    if (num_filters <= 256) argmax_quantized_simd(tensor_ptr, (int8_t*)mat_ptr, multiplier, offset, num_filters, mat_size);
+    else argmax_quantized_tensor(tensor_ptr, mat_ptr, multiplier, offset, num_filters, mat_size);
+}
+
+void argmax_quantized_simd(
+    const int8_t* tensor_ptr,
+    uint8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa)
+{
+    if (num_filters <= 256) argmax_quantized_impl(isa)(tensor_ptr, (int8_t*)mat_ptr, multiplier, offset, num_filters, mat_size);
+    else argmax_quantized_tensor(tensor_ptr, mat_ptr, multiplier, offset, num_filters, mat_size);
+}
+
+static argmax_tensor_fn argmax_planar_impl(const Simd_Isa isa)
+{
+    if (!simd_isa_supported(isa)) return argmax_planar_scalar;
+    switch (isa)
+    {
+#if ARGMAX_SIMD_X86 == 1
+    case Simd_Isa::sse41: return argmax_planar_sse41;
+    case Simd_Isa::avx2: return argmax_planar_avx2;
+    case Simd_Isa::avx512bw: return argmax_planar_avx512bw;
+#endif
+    default: return argmax_planar_scalar;
+    }
+}
+
+void argmax_planar_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    static const argmax_tensor_fn impl = argmax_planar_impl(simd_isa_best());
+    impl(tensor_ptr, mat_ptr, num_filters, mat_size);
+}
+
+void argmax_planar_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa)
+{
+    argmax_planar_impl(isa)(tensor_ptr, mat_ptr, num_filters, mat_size);
+}
+
+void argmax_planar_simd(
+    const int8_t* tensor_ptr,
+    uint8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    if (num_filters <= 256) argmax_planar_simd(tensor_ptr, (int8_t*)mat_ptr, num_filters, mat_size);
+    else argmax_planar(tensor_ptr, mat_ptr, num_filters, mat_size);
+}
+
+void argmax_planar_simd(
+    const int8_t* tensor_ptr,
+    uint8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa)
+{
+    if (num_filters <= 256) argmax_planar_impl(isa)(tensor_ptr, (int8_t*)mat_ptr, num_filters, mat_size);
+    else argmax_planar(tensor_ptr, mat_ptr, num_filters, mat_size);
+}
+
+void argmax_tensor_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Tensor_Layout layout)
+{
+    if (layout == Tensor_Layout::planar) argmax_planar_simd(tensor_ptr, mat_ptr, num_filters, mat_size);
+    else argmax_tensor_simd(tensor_ptr, mat_ptr, num_filters, mat_size);
+}
+
+void broadcast_bytes_simd(
+    const int8_t* src_ptr,
+    int8_t* const dst_ptr,
+    const unsigned int count,
+    const unsigned int scale_up_factor)
+{
+#if ARGMAX_SIMD_X86 == 1
+    static const bool has_ssse3 = simd_isa_supported(Simd_Isa::sse41);
+    if (has_ssse3 && scale_up_factor > 0 && scale_up_factor <= 16 && 16 % scale_up_factor == 0)
+    {
+        broadcast_bytes_ssse3(src_ptr, dst_ptr, count, scale_up_factor);
+        return;
+    }
+#endif
+    int8_t* dst_cptr = dst_ptr;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        memset(dst_cptr, src_ptr[i], scale_up_factor);
+        dst_cptr += scale_up_factor;
+    }
+}
+
+void gather_bytes_simd(
+    const int8_t* src_ptr,
+    const unsigned int src_count,
+    int8_t* const dst_ptr,
+    const unsigned int dst_count,
+    const unsigned int* column_index,
+    const int8_t* column_shuffle)
+{
+#if ARGMAX_SIMD_X86 == 1
+    static const bool has_ssse3 = simd_isa_supported(Simd_Isa::sse41);
+    if (has_ssse3)
+    {
+        gather_bytes_ssse3(src_ptr, src_count, dst_ptr, dst_count, column_index, column_shuffle);
+        return;
+    }
+#endif
+    for (unsigned int c = 0; c < dst_count; c++) dst_ptr[c] = src_ptr[column_index[c]];
+}
+
+static bilinear_argmax_row_fn bilinear_argmax_row_impl(const Simd_Isa isa)
+{
+    if (!simd_isa_supported(isa)) return bilinear_argmax_row_scalar;
+    switch (isa)
+    {
+#if ARGMAX_SIMD_X86 == 1
+    // one kernel serves every x86 level, a pixel only spans a few 128 bit vectors
+    case Simd_Isa::sse41:
+    case Simd_Isa::avx2:
+    case Simd_Isa::avx512bw: return bilinear_argmax_row_sse41;
+#endif
+    default: return bilinear_argmax_row_scalar;
+    }
+}
+
+void bilinear_argmax_row_simd(
+    const int8_t* row0_ptr,
+    const int8_t* row1_ptr,
+    const unsigned int row_weight,
+    int8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* column_index,
+    const uint8_t* column_weight)
+{
+    static const bilinear_argmax_row_fn impl = bilinear_argmax_row_impl(simd_isa_best());
+    impl(row0_ptr, row1_ptr, row_weight, mat_row_ptr, num_filters, num_columns, scaled_up_num_columns, column_index, column_weight);
+}
+
+void bilinear_argmax_row_simd(
+    const int8_t* row0_ptr,
+    const int8_t* row1_ptr,
+    const unsigned int row_weight,
+    int8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* column_index,
+    const uint8_t* column_weight,
+    const Simd_Isa isa)
+{
+    bilinear_argmax_row_impl(isa)(row0_ptr, row1_ptr, row_weight, mat_row_ptr, num_filters, num_columns, scaled_up_num_columns, column_index, column_weight);
+}
+
+void bilinear_argmax_row_simd(
+    const int8_t* row0_ptr,
+    const int8_t* row1_ptr,
+    const unsigned int row_weight,
+    uint8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* column_index,
+    const uint8_t* column_weight)
+{
+    if (num_filters <= 256)
+    {
+        bilinear_argmax_row_simd(row0_ptr, row1_ptr, row_weight, (int8_t*)mat_row_ptr, num_filters, num_columns, scaled_up_num_columns, column_index, column_weight);
+        return;
+    }
+    bilinear_argmax_row<int8_t, uint8_t>(row0_ptr, row1_ptr, row_weight, mat_row_ptr, num_filters, num_columns, scaled_up_num_columns, column_index, column_weight);
+}
+
+void bilinear_argmax_row_simd(
+    const int8_t* row0_ptr,
+    const int8_t* row1_ptr,
+    const unsigned int row_weight,
+    uint8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* column_index,
+    const uint8_t* column_weight,
+    const Simd_Isa isa)
+{
+    if (num_filters <= 256)
+    {
+        bilinear_argmax_row_impl(isa)(row0_ptr, row1_ptr, row_weight, (int8_t*)mat_row_ptr, num_filters, num_columns, scaled_up_num_columns, column_index, column_weight);
+        return;
+    }
+    bilinear_argmax_row<int8_t, uint8_t>(row0_ptr, row1_ptr, row_weight, mat_row_ptr, num_filters, num_columns, scaled_up_num_columns, column_index, column_weight);
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstdint>
+
+// instruction sets the int8 argmax kernels are compiled for
+enum class Simd_Isa
+{
+    scalar = 0,
+    sse41,
+    avx2,
+    avx512bw
+};
+
+const char* simd_isa_name(const Simd_Isa isa);
+
+// true if the kernel for isa is compiled in and the running CPU supports it
+bool simd_isa_supported(const Simd_Isa isa);
+
+// memory layout of a single frame of output logits
+enum class Tensor_Layout
+{
+    channel_last = 0,   // (rows, columns, filters), what argmax_tensor reads
+    planar              // (filters, rows, columns), one plane per class
+};
+
+// best supported isa, resolved once from CPUID on first use
+Simd_Isa simd_isa_best();
+
+// channel-last argmax over int8 cells, same result as argmax_tensor (first index wins on ties)
+void argmax_tensor_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size);
+
+// same as above but forced to a given isa, falls back to scalar if it is not supported
+void argmax_tensor_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa);
+
+// channel-last argmax that also writes the winning logit to value_ptr and its margin over the runner-up class to
+// margin_ptr in the same pass, same result as argmax_top2_tensor. either plane may be null
+void argmax_top2_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    int8_t* const value_ptr,
+    uint8_t* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size);
+
+void argmax_top2_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    int8_t* const value_ptr,
+    uint8_t* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa);
+
+// argmax over the int32 dequantization keys multiplier[f] * q + offset[f] of int8 cells, same result as
+// argmax_quantized_tensor. both tables are padded to a multiple of 8 with multiplier 0 and offset INT32_MIN (see Quant_Plan)
+void argmax_quantized_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size);
+
+void argmax_quantized_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa);
+
+// uint8 indices, the kernels store the low byte of the index, which is the whole index up to 256 classes.
+// more classes go through the scalar kernel
+void argmax_quantized_simd(
+    const int8_t* tensor_ptr,
+    uint8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size);
+
+void argmax_quantized_simd(
+    const int8_t* tensor_ptr,
+    uint8_t* const mat_ptr,
+    const int32_t* multiplier,
+    const int32_t* offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa);
+
+// planar argmax, a running elementwise max across the planes, same result as argmax_planar
+void argmax_planar_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size);
+
+void argmax_planar_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa);
+
+// uint8 indices, vector kernels up to 256 classes and the scalar one past that
+void argmax_planar_simd(
+    const int8_t* tensor_ptr,
+    uint8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size);
+
+void argmax_planar_simd(
+    const int8_t* tensor_ptr,
+    uint8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Simd_Isa isa);
+
+// layout-aware entry point, planar input is reduced in place without a transpose
+void argmax_tensor_simd(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const Tensor_Layout layout);
+
+// nearest-neighbour byte upsample of one row, every src byte is written scale_up_factor times into dst
+void broadcast_bytes_simd(
+    const int8_t* src_ptr,
+    int8_t* const dst_ptr,
+    const unsigned int count,
+    const unsigned int scale_up_factor);
+
+// table driven nearest-neighbour byte upsample of one row, dst[c] = src[column_index[c]].
+// column_shuffle[c] is column_index[c] minus the index of the first column of its 16 wide block,
+// every entry must be below 16 (true whenever the row is not shrunk)
+void gather_bytes_simd(
+    const int8_t* src_ptr,
+    const unsigned int src_count,
+    int8_t* const dst_ptr,
+    const unsigned int dst_count,
+    const unsigned int* column_index,
+    const int8_t* column_shuffle);
+
+// fused bilinear upsample + argmax of one output row of int8 logits, the upsampled logits are never stored.
+// row0_ptr/row1_ptr are the two source rows, row_weight the Q4 weight (0..16) of row1.
+// output column c blends source columns column_index[c] and column_index[c] + 1 with the Q4 weight column_weight[c],
+// column_weight[c] must be 0 when column_index[c] is the last source column.
+// the blended logit of every class is exact in int16, the first class wins on ties
+void bilinear_argmax_row_simd(
+    const int8_t* row0_ptr,
+    const int8_t* row1_ptr,
+    const unsigned int row_weight,
+    int8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* column_index,
+    const uint8_t* column_weight);
+
+void bilinear_argmax_row_simd(
+    const int8_t* row0_ptr,
+    const int8_t* row1_ptr,
+    const unsigned int row_weight,
+    int8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* column_index,
+    const uint8_t* column_weight,
+    const Simd_Isa isa);
+
+// uint8 indices, vector kernels up to 256 classes and the scalar one past that
+void bilinear_argmax_row_simd(
+    const int8_t* row0_ptr,
+    const int8_t* row1_ptr,
+    const unsigned int row_weight,
+    uint8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* column_index,
+    const uint8_t* column_weight);
+
+void bilinear_argmax_row_simd(
+    const int8_t* row0_ptr,
+    const int8_t* row1_ptr,
+    const unsigned int row_weight,
+    uint8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* column_index,
+    const uint8_t* column_weight,
+    const Simd_Isa isa);
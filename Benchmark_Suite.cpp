@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Thread_Pool.hpp"
+#include "Argmax_Simd.hpp"
+#include "Tools.hpp"
+#include "Connected_Components.hpp"
+
+// kernel sweeps over shapes, thread counts and variants, written as JSON and optionally checked against a baseline :
+//     benchmark_suite [--json out.json] [--baseline base.json] [--max-slowdown percent] [--warmup n] [--repetitions n]
+//                     [--threads 1,2,4] [--shapes 28x28x21x8,56x56x21x4] [--filter text]
+// exit code 0 when every benchmark is within max-slowdown of its baseline median, 1 on a regression, 2 on bad arguments
+
+struct Suite_Options
+{
+    std::string json_path = "benchmark.json";
+    std::string baseline_path;
+    std::string filter;
+    double max_slowdown = 10.0;   // percent over the baseline median
+    unsigned int warmup = 20;
+    unsigned int repetitions = 200;
+    std::vector<unsigned int> threads;
+    std::vector<std::vector<unsigned int>> shapes;  // rows, columns, filters, scale
+};
+
+struct Suite_Result
+{
+    std::string name;
+    std::string kernel;
+    unsigned int rows;
+    unsigned int columns;
+    unsigned int filters;
+    unsigned int scale;
+    unsigned int threads;
+    size_t samples;
+    size_t rejected;
+    double median_us;
+    double mean_us;
+    double min_us;
+    double p90_us;
+    double stddev_us;
+};
+
+static std::vector<std::string> split(const std::string& text, const char separator)
+{
+    std::vector<std::string> items;
+    size_t begin = 0;
+    while (begin <= text.size())
+    {
+        size_t end = text.find(separator, begin);
+        if (end == std::string::npos) end = text.size();
+        items.push_back(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return items;
+}
+
+// positive integers only, empty on anything else
+static std::vector<unsigned int> parse_list(const std::string& text, const char separator)
+{
+    std::vector<unsigned int> values;
+    for (const std::string& item : split(text, separator))
+    {
+        if (item.empty() || item.find_first_not_of("0123456789") != std::string::npos) return {};
+        const unsigned int value = (unsigned int)std::strtoul(item.c_str(), nullptr, 10);
+        if (value == 0) return {};
+        values.push_back(value);
+    }
+    return values;
+}
+
+static bool parse_options(const int argc, char** argv, Suite_Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const std::string value = argv[++i];
+        if (arg == "--json") options.json_path = value;
+        else if (arg == "--baseline") options.baseline_path = value;
+        else if (arg == "--filter") options.filter = value;
+        else if (arg == "--max-slowdown") options.max_slowdown = std::strtod(value.c_str(), nullptr);
+        else if (arg == "--warmup") options.warmup = (unsigned int)std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--repetitions") options.repetitions = (unsigned int)std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--threads")
+        {
+            options.threads = parse_list(value, ',');
+            if (options.threads.empty()) return false;
+        }
+        else if (arg == "--shapes")
+        {
+            options.shapes.clear();
+            for (const std::string& shape : split(value, ','))
+            {
+                const std::vector<unsigned int> dims = parse_list(shape, 'x');
+                if (dims.size() != 4) return false;
+                options.shapes.push_back(dims);
+            }
+        }
+        else return false;
+    }
+    return options.repetitions > 0;
+}
+
+// warmup untimed calls, then one sample per call. samples beyond the Tukey fences (1.5 IQR outside the quartiles)
+// are taken as interference from the rest of the machine and dropped before the statistics
+static void measure(const Suite_Options& options, Suite_Result& result, const std::function<void()>& body)
+{
+    typedef std::chrono::steady_clock clock_type;
+    for (unsigned int i = 0; i < options.warmup; i++) body();
+    std::vector<double> samples(options.repetitions);
+    for (auto& sample : samples)
+    {
+        const auto start = clock_type::now();
+        body();
+        sample = std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+    }
+    std::sort(samples.begin(), samples.end());
+    auto quantile = [](const std::vector<double>& sorted, const double q){
+        return sorted[std::min(sorted.size() - 1, (size_t)(q * (sorted.size() - 1) + 0.5))];
+    };
+    const double q1 = quantile(samples, 0.25);
+    const double q3 = quantile(samples, 0.75);
+    const double low = q1 - 1.5 * (q3 - q1);
+    const double high = q3 + 1.5 * (q3 - q1);
+    std::vector<double> kept;
+    for (const double sample : samples)
+    {
+        if (sample >= low && sample <= high) kept.push_back(sample);
+    }
+
+    double sum = 0.0;
+    for (const double sample : kept) sum += sample;
+    const double mean = sum / kept.size();
+    double squares = 0.0;
+    for (const double sample : kept) squares += (sample - mean) * (sample - mean);
+
+    result.samples = kept.size();
+    result.rejected = samples.size() - kept.size();
+    result.median_us = quantile(kept, 0.5);
+    result.mean_us = mean;
+    result.min_us = kept.front();
+    result.p90_us = quantile(kept, 0.9);
+    result.stddev_us = std::sqrt(squares / kept.size());
+}
+
+static std::vector<Suite_Result> run_suite(const Suite_Options& options)
+{
+    std::vector<Suite_Result> results;
+    for (const auto& shape : options.shapes)
+    {
+        const unsigned int rows = shape[0];
+        const unsigned int columns = shape[1];
+        const unsigned int filters = shape[2];
+        const unsigned int scale = shape[3];
+        const unsigned int mat_size = rows * columns;
+        const unsigned int scaled_up_rows = rows * scale;
+        const unsigned int scaled_up_columns = columns * scale;
+        const unsigned int scaled_up_mat_size = scaled_up_rows * scaled_up_columns;
+
+        std::vector<int8_t> tensor((size_t)mat_size * filters);
+        std::vector<int8_t> mat(mat_size);
+        std::vector<int8_t> scaled_up_tensor((size_t)scaled_up_mat_size * filters);
+        std::vector<int8_t> scaled_up_mat(scaled_up_mat_size);
+        std::vector<int8_t> scaled_up_value(scaled_up_mat_size);
+        std::vector<uint8_t> scaled_up_margin(scaled_up_mat_size);
+        const unsigned int mask_bits = filters <= 256 ? mask_bits_for_classes(filters) : 0;
+        std::vector<uint8_t> scaled_up_packed(packed_mask_size(scaled_up_mat_size, mask_bits));
+        srand(rows * 131 + columns * 31 + filters * 7 + scale);
+        for (auto& item : tensor) item = rand() % 256 - 128;
+        Quant_Params quant_params;
+        for (unsigned int f = 0; f < filters; f++)
+        {
+            quant_params.scale.push_back(0.01f + 0.001f * f);
+            quant_params.zero_point.push_back((int32_t)(f % 7) - 3);
+        }
+        Quant_Plan quant_plan;
+        make_quant_plan(quant_params, filters, quant_plan);
+        const Upsample_Plan upsample_plan = make_upsample_plan(rows, columns, scaled_up_rows, scaled_up_columns);
+        const Bilinear_Plan bilinear_plan = make_bilinear_plan(rows, columns, scaled_up_rows, scaled_up_columns);
+        // the labeling runs on a class map of its own, the kernels above overwrite mat and scaled_up_mat
+        std::vector<uint8_t> class_mat(mat_size);
+        std::vector<uint8_t> scaled_up_class_mat(scaled_up_mat_size);
+        argmax_tensor(tensor.data(), class_mat.data(), filters, mat_size);
+        upsampler(class_mat.data(), scaled_up_class_mat.data(), rows, columns, 1, scale);
+        obj_detect::Connected_Components components;
+        std::vector<obj_detect::Region> scaled_up_regions;
+
+        const std::string shape_name = std::to_string(rows) + "x" + std::to_string(columns) + "x" + std::to_string(filters) + "x" + std::to_string(scale);
+        auto run = [&](const std::string& kernel, const unsigned int threads, const std::function<void()>& body){
+            Suite_Result result{};
+            result.kernel = kernel;
+            result.name = kernel + "/" + shape_name + "/T" + std::to_string(threads);
+            if (!options.filter.empty() && result.name.find(options.filter) == std::string::npos) return;
+            result.rows = rows;
+            result.columns = columns;
+            result.filters = filters;
+            result.scale = scale;
+            result.threads = threads;
+            measure(options, result, body);
+            std::cout << std::left << std::setw(50) << result.name
+                << std::left << std::setw(14) << result.median_us
+                << std::left << std::setw(14) << result.p90_us
+                << std::left << std::setw(10) << result.rejected << std::endl;
+            results.push_back(result);
+        };
+
+        // single threaded variants
+        run("argmax", 1, [&](){ argmax_tensor(tensor.data(), mat.data(), filters, mat_size); });
+        run("argmax_simd", 1, [&](){ argmax_tensor_simd(tensor.data(), mat.data(), filters, mat_size); });
+        run("argmax_top2_simd", 1, [&](){
+            argmax_top2_simd(tensor.data(), mat.data(), scaled_up_value.data(), scaled_up_margin.data(), filters, mat_size);
+        });
+        run("argmax_quantized_simd", 1, [&](){
+            argmax_quantized_simd(tensor.data(), mat.data(), quant_plan.multiplier.data(), quant_plan.offset.data(), filters, mat_size);
+        });
+        run("upsampler->argmax", 1, [&](){
+            upsampler(tensor.data(), scaled_up_tensor.data(), rows, columns, filters, scale);
+            argmax_tensor(scaled_up_tensor.data(), scaled_up_mat.data(), filters, scaled_up_mat_size);
+        });
+
+        for (const unsigned int threads : options.threads)
+        {
+            obj_detect::Thread_Pool thread_pool(threads, obj_detect::Scheduler::lock_free_queue, obj_detect::Idle_Policy::spin_then_park);
+            run("argmax_mt", threads, [&](){ argmax_tensor_mt(tensor.data(), mat.data(), filters, mat_size, thread_pool, obj_detect::Partition::dynamic, columns); });
+            run("upsampler_mt->argmax_mt", threads, [&](){
+                upsampler_mt(tensor.data(), scaled_up_tensor.data(), upsample_plan, filters, thread_pool);
+                argmax_tensor_mt(scaled_up_tensor.data(), scaled_up_mat.data(), filters, scaled_up_mat_size, thread_pool, obj_detect::Partition::dynamic, scaled_up_columns);
+            });
+            run("argmax_up_scale_mt", threads, [&](){ argmax_up_scale_mt(tensor.data(), scaled_up_mat.data(), rows, columns, filters, scale, thread_pool); });
+            run("argmax_top2_up_scale_mt", threads, [&](){
+                argmax_top2_up_scale_mt(tensor.data(), scaled_up_mat.data(), scaled_up_value.data(), scaled_up_margin.data(),
+                    rows, columns, filters, scale, thread_pool);
+            });
+            if (mask_bits > 0)
+            {
+                run("argmax_up_scale_packed_mt", threads, [&](){
+                    argmax_up_scale_packed_mt(tensor.data(), scaled_up_packed.data(), rows, columns, filters, scale, mask_bits, thread_pool);
+                });
+            }
+            run("connected_components_mt", threads, [&](){
+                components.label(scaled_up_class_mat.data(), scaled_up_rows, scaled_up_columns, thread_pool);
+            });
+            run("connected_components_scaled_mt", threads, [&](){
+                components.label(class_mat.data(), rows, columns, thread_pool);
+                scaled_up_regions.assign(components.regions().begin(), components.regions().end());
+                obj_detect::scale_regions(scaled_up_regions, scale);
+            });
+            run("bilinear_argmax_mt", threads, [&](){ bilinear_argmax_mt(tensor.data(), scaled_up_mat.data(), bilinear_plan, filters, thread_pool); });
+        }
+    }
+    return results;
+}
+
+// one benchmark object per line, so the baseline reader only has to look at single lines
+static bool write_json(const std::string& path, const Suite_Options& options, const std::vector<Suite_Result>& results)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Benchmark json " << path << " : not opened\n";
+        return false;
+    }
+    file.precision(6);
+    file << std::fixed;
+    file << "{\n\"simd\":\"" << simd_isa_name(simd_isa_best()) << "\",\n\"hardware_threads\":" << std::thread::hardware_concurrency()
+        << ",\n\"warmup\":" << options.warmup << ",\n\"repetitions\":" << options.repetitions << ",\n\"benchmarks\":[\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Suite_Result& result = results[i];
+        file << "{\"name\":\"" << result.name << "\",\"kernel\":\"" << result.kernel << "\""
+            << ",\"rows\":" << result.rows << ",\"columns\":" << result.columns << ",\"filters\":" << result.filters
+            << ",\"scale\":" << result.scale << ",\"threads\":" << result.threads
+            << ",\"samples\":" << result.samples << ",\"rejected\":" << result.rejected
+            << ",\"median_us\":" << result.median_us << ",\"mean_us\":" << result.mean_us << ",\"min_us\":" << result.min_us
+            << ",\"p90_us\":" << result.p90_us << ",\"stddev_us\":" << result.stddev_us << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "]\n}\n";
+    return file.good();
+}
+
+// name -> median_us of a file written by write_json, false if it cannot be read
+static bool read_baseline(const std::string& path, std::map<std::string, double>& medians)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Baseline " << path << " : not opened\n";
+        return false;
+    }
+    const std::string name_key = "\"name\":\"";
+    const std::string median_key = "\"median_us\":";
+    for (std::string line; std::getline(file, line);)
+    {
+        const size_t name_pos = line.find(name_key);
+        const size_t median_pos = line.find(median_key);
+        if (name_pos == std::string::npos || median_pos == std::string::npos) continue;
+        const size_t name_begin = name_pos + name_key.size();
+        const size_t name_end = line.find('"', name_begin);
+        if (name_end == std::string::npos) continue;
+        medians[line.substr(name_begin, name_end - name_begin)] = std::strtod(line.c_str() + median_pos + median_key.size(), nullptr);
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Suite_Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << "usage : " << argv[0] << " [--json out.json] [--baseline base.json] [--max-slowdown percent] [--warmup n]"
+            << " [--repetitions n] [--threads 1,2,4] [--shapes 28x28x21x8,...] [--filter text]\n";
+        return 2;
+    }
+    if (options.threads.empty())
+    {
+        const unsigned int hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int threads = 1; threads < hardware_threads; threads *= 2) options.threads.push_back(threads);
+        options.threads.push_back(hardware_threads);
+    }
+    if (options.shapes.empty()) options.shapes = {{28, 28, 21, 8}, {56, 56, 21, 4}, {112, 112, 21, 2}};
+
+    std::map<std::string, double> baseline;
+    if (!options.baseline_path.empty() && !read_baseline(options.baseline_path, baseline)) return 2;
+
+    std::cout << std::left << std::setw(50) << "Benchmark" << std::left << std::setw(14) << "Median (us)"
+        << std::left << std::setw(14) << "P90 (us)" << std::left << std::setw(10) << "Rejected" << std::endl << std::endl;
+    const std::vector<Suite_Result> results = run_suite(options);
+    if (!write_json(options.json_path, options, results)) return 2;
+    std::cout << std::endl << "Results written to " << options.json_path << std::endl;
+    if (options.baseline_path.empty()) return 0;
+
+    unsigned int num_regressions = 0;
+    std::cout << std::endl << std::left << std::setw(50) << "Against " + options.baseline_path
+        << std::left << std::setw(14) << "Baseline" << std::left << std::setw(14) << "Change (%)" << std::endl << std::endl;
+    for (const auto& result : results)
+    {
+        const auto it = baseline.find(result.name);
+        if (it == baseline.end() || it->second <= 0.0)
+        {
+            std::cout << std::left << std::setw(50) << result.name << "not in baseline" << std::endl;
+            continue;
+        }
+        const double change = 100.0 * (result.median_us - it->second) / it->second;
+        const bool regression = change > options.max_slowdown;
+        num_regressions += regression;
+        std::cout << std::left << std::setw(50) << result.name << std::left << std::setw(14) << it->second
+            << std::left << std::setw(14) << change << (regression ? "REGRESSION" : "") << std::endl;
+    }
+    std::cout << std::endl << num_regressions << " regression(s) over " << options.max_slowdown << "%" << std::endl;
+    return num_regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "Thread_Pool.hpp"
+#include "Probe.hpp"
+
+namespace obj_detect
+{
+    // which neighbours of a pixel belong to the same blob when they have its class
+    enum class Connectivity
+    {
+        four,   // pixels sharing an edge
+        eight   // pixels sharing an edge or a corner
+    };
+
+    // one connected blob of pixels of the same class, the bounding box is inclusive
+    struct Region
+    {
+        unsigned int class_index;
+        uint64_t area;
+        unsigned int min_row;
+        unsigned int min_column;
+        unsigned int max_row;
+        unsigned int max_column;
+        double centroid_row;
+        double centroid_column;
+    };
+
+    // every blob of one class taken together, the bounding box is only set when num_regions > 0
+    struct Class_Stats
+    {
+        uint64_t area;
+        unsigned int num_regions;
+        unsigned int min_row;
+        unsigned int min_column;
+        unsigned int max_row;
+        unsigned int max_column;
+    };
+
+    // connected component labeling of a class mask with per-region area, bounding box and centroid.
+    // the rows are cut in full width strips, one per thread, and every strip runs its own union-find in parallel.
+    // the strip borders are then merged on the calling thread, which costs one row per strip, and the labels and
+    // region statistics are resolved in parallel again. buffers are kept between calls, so labeling masks of
+    // one size does not allocate after the first frame
+    class Connected_Components
+    {
+    public:
+        static constexpr uint32_t no_label = UINT32_MAX;
+        static constexpr unsigned int no_background = UINT_MAX;
+
+        Connected_Components() = default;
+
+        Connected_Components(const Connected_Components&) = delete;
+
+        // labels the (num_rows, num_columns) mask. pixels of class background get no_label and no region, regions
+        // are numbered in raster order of their first pixel so the result does not depend on the thread count
+        template <typename I>
+        void label(const I* mask_ptr, const unsigned int num_rows, const unsigned int num_columns, Thread_Pool& thread_pool,
+            const Connectivity connectivity = Connectivity::four, const unsigned int background = no_background, const unsigned int min_strip_rows = 4);
+
+        const std::vector<Region>& regions() const
+        {
+            return _regions;
+        }
+
+        // region index of every pixel of the last mask, no_label on background
+        const std::vector<uint32_t>& labels() const
+        {
+            return _labels;
+        }
+    private:
+        struct Accumulator
+        {
+            uint32_t root;          // first pixel of the blob inside the strip
+            uint32_t target;        // first pixel of the region it belongs to once the strips are merged
+            uint32_t id;            // region index once the strips are merged
+            unsigned int class_index;
+            uint64_t area;
+            uint64_t row_sum;
+            uint64_t column_sum;
+            unsigned int min_row;
+            unsigned int min_column;
+            unsigned int max_row;
+            unsigned int max_column;
+        };
+
+        struct Strip
+        {
+            unsigned int first_row;
+            unsigned int end_row;
+            uint32_t first_id;
+            uint32_t num_roots;
+            std::vector<Accumulator> blobs;
+        };
+
+        // signed indices are read as their unsigned bytes, like the int8 masks of the argmax kernels
+        template <typename I>
+        static unsigned int class_of(const I value)
+        {
+            return (unsigned int)(typename std::make_unsigned<I>::type)value;
+        }
+
+        // parents always have a smaller index than their children, so the root of a blob is its first pixel
+        uint32_t find(uint32_t pixel)
+        {
+            while (_parent[pixel] != pixel)
+            {
+                _parent[pixel] = _parent[_parent[pixel]];
+                pixel = _parent[pixel];
+            }
+            return pixel;
+        }
+
+        // no path compression, safe while other threads walk the same trees
+        uint32_t find_root(uint32_t pixel) const
+        {
+            while (_parent[pixel] != pixel) pixel = _parent[pixel];
+            return pixel;
+        }
+
+        void unite(const uint32_t first, const uint32_t second)
+        {
+            const uint32_t first_root = find(first);
+            const uint32_t second_root = find(second);
+            if (first_root < second_root) _parent[second_root] = first_root;
+            else _parent[first_root] = second_root;
+        }
+
+        template <typename I>
+        void label_strip(const I* mask_ptr, Strip& strip, const unsigned int num_columns, const Connectivity connectivity, const unsigned int background);
+
+        template <typename I>
+        void merge_border(const I* mask_ptr, const unsigned int row, const unsigned int num_columns, const Connectivity connectivity);
+
+        std::vector<uint32_t> _parent;
+        std::vector<uint32_t> _labels;
+        std::vector<Strip> _strips;
+        std::vector<unsigned int> _strip_of_row;
+        std::vector<Region> _regions;
+    };
+
+    // union-find inside rows [first_row, end_row), then every blob is summed up in the first pass that meets it.
+    // _labels holds the blob index inside the strip until the strips are merged
+    template <typename I>
+    void Connected_Components::label_strip(const I* mask_ptr, Strip& strip, const unsigned int num_columns, const Connectivity connectivity, const unsigned int background)
+    {
+        const bool eight = connectivity == Connectivity::eight;
+        for (unsigned int r = strip.first_row; r < strip.end_row; r++)
+        {
+            const uint32_t row_pixel = r * num_columns;
+            uint32_t run_first = row_pixel;
+            for (unsigned int c = 0; c < num_columns; c++)
+            {
+                const uint32_t pixel = row_pixel + c;
+                const I value = mask_ptr[pixel];
+                if (class_of(value) == background)
+                {
+                    _parent[pixel] = no_label;
+                    continue;
+                }
+                // a run of one class hangs off its first pixel, which keeps the parent chain out of the loop
+                const bool left = c > 0 && mask_ptr[pixel - 1] == value;
+                if (!left) run_first = pixel;
+                _parent[pixel] = run_first;
+                if (r == strip.first_row) continue;
+                // neighbours already joined through the left pixel or the one above are skipped
+                const uint32_t up = pixel - num_columns;
+                if (mask_ptr[up] == value)
+                {
+                    if (!left || mask_ptr[up - 1] != value) unite(up, pixel);
+                    continue;
+                }
+                if (!eight) continue;
+                if (c > 0 && !left && mask_ptr[up - 1] == value) unite(up - 1, pixel);
+                if (c + 1 < num_columns && mask_ptr[up + 1] == value) unite(up + 1, pixel);
+            }
+        }
+
+        // a parent comes before its child, so one forward pass flattens every tree
+        const uint32_t first_pixel = strip.first_row * num_columns;
+        const uint32_t end_pixel = strip.end_row * num_columns;
+        for (uint32_t pixel = first_pixel; pixel < end_pixel; pixel++)
+        {
+            if (_parent[pixel] != no_label) _parent[pixel] = _parent[_parent[pixel]];
+        }
+
+        // statistics are summed a run of one root at a time
+        strip.blobs.clear();
+        for (unsigned int r = strip.first_row; r < strip.end_row; r++)
+        {
+            const uint32_t row_pixel = r * num_columns;
+            unsigned int c = 0;
+            while (c < num_columns)
+            {
+                const uint32_t pixel = row_pixel + c;
+                const uint32_t root = _parent[pixel];
+                unsigned int run_end = c + 1;
+                while (run_end < num_columns && _parent[row_pixel + run_end] == root) run_end++;
+                if (root == no_label)
+                {
+                    std::fill(_labels.begin() + pixel, _labels.begin() + row_pixel + run_end, no_label);
+                    c = run_end;
+                    continue;
+                }
+                if (root == pixel)
+                {
+                    _labels[pixel] = (uint32_t)strip.blobs.size();
+                    strip.blobs.push_back({pixel, pixel, no_label, class_of(mask_ptr[pixel]), 0, 0, 0, r, c, r, c});
+                }
+                const uint32_t blob_index = _labels[root];
+                std::fill(_labels.begin() + pixel, _labels.begin() + row_pixel + run_end, blob_index);
+                const uint64_t run_size = run_end - c;
+                Accumulator& blob = strip.blobs[blob_index];
+                blob.area += run_size;
+                blob.row_sum += run_size * r;
+                blob.column_sum += run_size * (c + run_end - 1) / 2;
+                blob.min_column = std::min(blob.min_column, c);
+                blob.max_column = std::max(blob.max_column, run_end - 1);
+                blob.max_row = r;
+                c = run_end;
+            }
+        }
+    }
+
+    // joins the blobs of the first row of a strip with the ones of the last row of the strip above it
+    template <typename I>
+    void Connected_Components::merge_border(const I* mask_ptr, const unsigned int row, const unsigned int num_columns, const Connectivity connectivity)
+    {
+        const bool eight = connectivity == Connectivity::eight;
+        const uint32_t row_pixel = row * num_columns;
+        for (unsigned int c = 0; c < num_columns; c++)
+        {
+            const uint32_t pixel = row_pixel + c;
+            if (_parent[pixel] == no_label) continue;
+            const I value = mask_ptr[pixel];
+            const uint32_t up = pixel - num_columns;
+            if (mask_ptr[up] == value) unite(up, pixel);
+            if (!eight) continue;
+            if (c > 0 && mask_ptr[up - 1] == value) unite(up - 1, pixel);
+            if (c + 1 < num_columns && mask_ptr[up + 1] == value) unite(up + 1, pixel);
+        }
+    }
+
+    template <typename I>
+    void Connected_Components::label(const I* mask_ptr, const unsigned int num_rows, const unsigned int num_columns, Thread_Pool& thread_pool,
+        const Connectivity connectivity, const unsigned int background, const unsigned int min_strip_rows)
+    {
+        PROBE_SCOPE("connected_components");
+        const size_t mat_size = (size_t)num_rows * num_columns;
+        _parent.resize(mat_size);
+        _labels.resize(mat_size);
+        _regions.clear();
+        if (mat_size == 0) return;
+
+        const unsigned int strip_rows = min_strip_rows > 0 ? min_strip_rows : 1;
+        const unsigned int max_strips = (num_rows + strip_rows - 1) / strip_rows;
+        const unsigned int num_strips = std::min(max_strips, thread_pool.get_num_threads());
+        if (_strips.size() < num_strips) _strips.resize(num_strips);
+        _strip_of_row.resize(num_rows);
+        for (unsigned int s = 0; s < num_strips; s++)
+        {
+            Strip& strip = _strips[s];
+            strip.first_row = (unsigned int)((uint64_t)num_rows * s / num_strips);
+            strip.end_row = (unsigned int)((uint64_t)num_rows * (s + 1) / num_strips);
+            for (unsigned int r = strip.first_row; r < strip.end_row; r++) _strip_of_row[r] = s;
+        }
+
+        thread_pool.parallel_for(0, num_strips, 1, [&](const unsigned int begin, const unsigned int end){
+            for (unsigned int s = begin; s < end; s++) label_strip(mask_ptr, _strips[s], num_columns, connectivity, background);
+        });
+
+        for (unsigned int s = 1; s < num_strips; s++) merge_border(mask_ptr, _strips[s].first_row, num_columns, connectivity);
+
+        // a blob whose first pixel is still a root after the merge becomes a region, the others are folded into it
+        thread_pool.parallel_for(0, num_strips, 1, [&](const unsigned int begin, const unsigned int end){
+            for (unsigned int s = begin; s < end; s++)
+            {
+                Strip& strip = _strips[s];
+                strip.num_roots = 0;
+                for (auto& blob : strip.blobs)
+                {
+                    blob.target = find_root(blob.root);
+                    if (blob.target == blob.root) strip.num_roots++;
+                }
+            }
+        });
+        uint32_t num_regions = 0;
+        for (unsigned int s = 0; s < num_strips; s++)
+        {
+            _strips[s].first_id = num_regions;
+            num_regions += _strips[s].num_roots;
+        }
+        _regions.resize(num_regions);
+        thread_pool.parallel_for(0, num_strips, 1, [&](const unsigned int begin, const unsigned int end){
+            for (unsigned int s = begin; s < end; s++)
+            {
+                Strip& strip = _strips[s];
+                uint32_t id = strip.first_id;
+                for (auto& blob : strip.blobs)
+                {
+                    if (blob.target == blob.root) blob.id = id++;
+                }
+            }
+        });
+
+        // only blobs joined across a strip border get here, the region they join starts at an earlier pixel
+        for (unsigned int s = 0; s < num_strips; s++)
+        {
+            for (auto& blob : _strips[s].blobs)
+            {
+                if (blob.id != no_label) continue;
+                Accumulator& target = _strips[_strip_of_row[blob.target / num_columns]].blobs[_labels[blob.target]];
+                target.area += blob.area;
+                target.row_sum += blob.row_sum;
+                target.column_sum += blob.column_sum;
+                target.min_column = std::min(target.min_column, blob.min_column);
+                target.max_column = std::max(target.max_column, blob.max_column);
+                target.max_row = std::max(target.max_row, blob.max_row);
+                blob.id = target.id;
+            }
+        }
+
+        thread_pool.parallel_for(0, num_strips, 1, [&](const unsigned int begin, const unsigned int end){
+            for (unsigned int s = begin; s < end; s++)
+            {
+                const Strip& strip = _strips[s];
+                for (const auto& blob : strip.blobs)
+                {
+                    if (blob.target != blob.root) continue;
+                    _regions[blob.id] = {blob.class_index, blob.area, blob.min_row, blob.min_column, blob.max_row, blob.max_column,
+                        (double)blob.row_sum / blob.area, (double)blob.column_sum / blob.area};
+                }
+                const uint32_t end_pixel = strip.end_row * num_columns;
+                for (uint32_t pixel = strip.first_row * num_columns; pixel < end_pixel; pixel++)
+                {
+                    if (_labels[pixel] != no_label) _labels[pixel] = strip.blobs[_labels[pixel]].id;
+                }
+            }
+        });
+    }
+
+    // regions of a mask labeled before a scale_up_factor nearest-neighbour upsample, turned into the regions of the
+    // upsampled mask : every pixel became a scale_up_factor square, so blobs, their order and their classes stay
+    // the same under both connectivities and only the geometry grows
+    inline void scale_regions(std::vector<Region>& regions, const unsigned int scale_up_factor)
+    {
+        const double centroid_offset = (scale_up_factor - 1) / 2.0;
+        for (auto& region : regions)
+        {
+            region.area *= (uint64_t)scale_up_factor * scale_up_factor;
+            region.min_row *= scale_up_factor;
+            region.min_column *= scale_up_factor;
+            region.max_row = (region.max_row + 1) * scale_up_factor - 1;
+            region.max_column = (region.max_column + 1) * scale_up_factor - 1;
+            region.centroid_row = region.centroid_row * scale_up_factor + centroid_offset;
+            region.centroid_column = region.centroid_column * scale_up_factor + centroid_offset;
+        }
+    }
+
+    // per-class pixel counts, blob counts and bounding boxes of classes [0, num_classes), regions of other classes are skipped
+    inline void region_class_stats(const std::vector<Region>& regions, const unsigned int num_classes, std::vector<Class_Stats>& stats)
+    {
+        stats.assign(num_classes, Class_Stats{0, 0, UINT_MAX, UINT_MAX, 0, 0});
+        for (const auto& region : regions)
+        {
+            if (region.class_index >= num_classes) continue;
+            Class_Stats& item = stats[region.class_index];
+            item.area += region.area;
+            item.num_regions++;
+            item.min_row = std::min(item.min_row, region.min_row);
+            item.min_column = std::min(item.min_column, region.min_column);
+            item.max_row = std::max(item.max_row, region.max_row);
+            item.max_column = std::max(item.max_column, region.max_column);
+        }
+        for (auto& item : stats)
+        {
+            if (item.num_regions == 0) item = Class_Stats{0, 0, 0, 0, 0, 0};
+        }
+    }
+}
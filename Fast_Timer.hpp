@@ -0,0 +1,491 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Latency_Histogram.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FAST_TIMER_X86 1
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+#if __linux__ == 1
+#include <ctime>
+#endif
+
+// cheapest monotonic tick source, the invariant TSC where the cpu has one, CLOCK_MONOTONIC nanoseconds otherwise
+class Tsc_Clock
+{
+public:
+    static uint64_t now()
+    {
+#if FAST_TIMER_X86 == 1
+        if (use_tsc) return __rdtsc();
+#endif
+#if __linux__ == 1
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static bool uses_tsc()
+    {
+        return use_tsc;
+    }
+
+    // measured once against steady_clock on first use, exactly 1 for the CLOCK_MONOTONIC fallback
+    static double ns_per_tick()
+    {
+        static const double ratio = calibrate();
+        return ratio;
+    }
+
+    static double to_ns(const uint64_t ticks)
+    {
+        return ticks * ns_per_tick();
+    }
+private:
+    // the TSC only counts wall time when it is invariant (constant rate, running in every C-state)
+    static bool detect_tsc()
+    {
+#if FAST_TIMER_X86 == 1
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) return false;
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+        return (edx & (1u << 8)) != 0;
+#else
+        return false;
+#endif
+    }
+
+    static double calibrate()
+    {
+        if (!use_tsc) return 1.0;
+        const auto wall_1 = std::chrono::steady_clock::now();
+        const uint64_t ticks_1 = now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const auto wall_2 = std::chrono::steady_clock::now();
+        const uint64_t ticks_2 = now();
+        return std::chrono::duration<double, std::nano>(wall_2 - wall_1).count() / (double)(ticks_2 - ticks_1);
+    }
+
+    static inline const bool use_tsc = detect_tsc();
+};
+
+// timer safe to use from any thread, with nested scopes. every thread records into its own buffer of events,
+// appended without locks or allocations (besides a new chunk every few thousand events, unless reserve() made
+// them up front), and the buffers are only merged when the results are read. names are interned once into ids so the hot path never touches a string.
+//     static const uint32_t id = Fast_Timer::Get().name_id("argmax row");
+//     Fast_Timer::Scope scope(id);
+class Fast_Timer
+{
+public:
+    static const unsigned int max_depth = 64;
+
+    // one closed scope, start and stop are Tsc_Clock ticks
+    struct Event
+    {
+        uint32_t name_id;
+        uint32_t depth;
+        uint64_t start;
+        uint64_t stop;
+    };
+
+    struct Stats
+    {
+        std::string name;
+        uint64_t count = 0;
+        double total_ms = 0.0;
+        double min_us = 0.0;
+        double max_us = 0.0;
+        Latency_Histogram histogram;    // durations in ns
+    };
+
+    class Scope
+    {
+    public:
+        Scope(const uint32_t name_id) { Fast_Timer::Get().start(name_id); }
+        Scope(const Scope&) = delete;
+        ~Scope() { Fast_Timer::Get().stop(); }
+    };
+
+    Fast_Timer(const Fast_Timer&) = delete;
+
+    static Fast_Timer& Get()
+    {
+        static Fast_Timer instance;
+        return instance;
+    }
+
+    // takes a lock, call it once per call site and keep the id
+    uint32_t name_id(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lck(_names_mutex);
+        const auto it = _name_ids.find(name);
+        if (it != _name_ids.end()) return it->second;
+        const uint32_t id = (uint32_t)_names.size();
+        _names.push_back(name);
+        _name_ids.emplace(name, id);
+        return id;
+    }
+
+    std::string name(const uint32_t name_id) const
+    {
+        std::lock_guard<std::mutex> lck(_names_mutex);
+        return name_id < _names.size() ? _names[name_id] : std::string();
+    }
+
+    void start(const uint32_t name_id)
+    {
+        Thread_Buffer& buffer = thread_buffer();
+        if (buffer.depth < max_depth) buffer.open[buffer.depth] = {name_id, Tsc_Clock::now()};
+        buffer.depth++;
+    }
+
+    void stop()
+    {
+        const uint64_t stop_ticks = Tsc_Clock::now();
+        Thread_Buffer& buffer = thread_buffer();
+        if (buffer.depth == 0) return;
+        buffer.depth--;
+        if (buffer.depth >= max_depth) return;
+        const Open_Scope& scope = buffer.open[buffer.depth];
+        buffer.append({scope.name_id, buffer.depth, scope.start, stop_ticks});
+    }
+
+    // slow path convenience, interns the name on every call
+    void start(const std::string& name)
+    {
+        start(name_id(name));
+    }
+
+    // per name totals over every thread, safe while other threads keep recording
+    std::vector<Stats> collect() const
+    {
+        std::vector<Stats> stats;
+        for_each_event([&stats](const unsigned int, const Event& event){
+            if (event.name_id >= stats.size()) stats.resize(event.name_id + 1);
+            Stats& item = stats[event.name_id];
+            const double ns = Tsc_Clock::to_ns(event.stop - event.start);
+            const double us = ns * 1e-3;
+            item.histogram.record((uint64_t)(ns + 0.5));
+            item.min_us = (item.count == 0 || us < item.min_us) ? us : item.min_us;
+            item.max_us = (item.count == 0 || us > item.max_us) ? us : item.max_us;
+            item.total_ms += us * 1e-3;
+            item.count++;
+        });
+        std::vector<Stats> named;
+        for (uint32_t id = 0; id < stats.size(); id++)
+        {
+            if (stats[id].count == 0) continue;
+            stats[id].name = name(id);
+            named.push_back(stats[id]);
+        }
+        return named;
+    }
+
+    // visits the events recorded so far, f(buffer_index, event), buffer_index tells the recording threads apart
+    template <typename F>
+    void for_each_event(F&& f) const
+    {
+        std::lock_guard<std::mutex> lck(_buffers_mutex);
+        for (unsigned int b = 0; b < _buffers.size(); b++)
+        {
+            const Thread_Buffer& buffer = *_buffers[b];
+            const size_t count = buffer.count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; i++)
+            {
+                f(b, buffer.event(i));
+            }
+        }
+    }
+
+    // names the calling thread's track in the exported trace, unnamed threads show up as "thread <index>"
+    void set_thread_name(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lck(_buffers_mutex);
+        tls_thread_name() = name;
+        if (tls_buffer() != nullptr) tls_buffer()->name = name;
+    }
+
+    // Chrome Trace Event JSON (opens in Perfetto or chrome://tracing), one complete event per closed scope
+    // on one track per recording thread, timestamps in microseconds from the first recorded scope.
+    // false (with a message on stderr) if the file cannot be written
+    bool write_chrome_trace(const std::string& path) const
+    {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Trace " << path << " : not opened\n";
+            return false;
+        }
+        const std::vector<std::string> names = name_snapshot();
+        const double ns_per_tick = Tsc_Clock::ns_per_tick();
+        std::lock_guard<std::mutex> lck(_buffers_mutex);
+        uint64_t origin = UINT64_MAX;
+        for (const auto& buffer : _buffers)
+        {
+            const size_t count = buffer->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; i++) origin = std::min(origin, buffer->event(i).start);
+        }
+
+        file.precision(3);
+        file << std::fixed << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"obj_detect\"}}";
+        for (unsigned int b = 0; b < _buffers.size(); b++)
+        {
+            const Thread_Buffer& buffer = *_buffers[b];
+            const size_t count = buffer.count.load(std::memory_order_acquire);
+            if (count == 0) continue;
+            const std::string track = buffer.name.empty() ? "thread " + std::to_string(b) : buffer.name;
+            file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b
+                << ",\"args\":{\"name\":\"" << json_escape(track) << "\"}}";
+            for (size_t i = 0; i < count; i++)
+            {
+                const Event& event = buffer.event(i);
+                const std::string& name = event.name_id < names.size() ? names[event.name_id] : std::string();
+                file << ",\n{\"name\":\"" << json_escape(name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b
+                    << ",\"ts\":" << (event.start - origin) * ns_per_tick * 1e-3
+                    << ",\"dur\":" << (event.stop - event.start) * ns_per_tick * 1e-3 << "}";
+            }
+        }
+        file << "\n]}\n";
+        return file.good();
+    }
+
+    // one line of aggregates per block for regression dashboards, durations in microseconds
+    bool write_csv(const std::string& path) const
+    {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "CSV " << path << " : not opened\n";
+            return false;
+        }
+        std::map<std::string, Stats> sorted;
+        for (const auto& item : collect()) sorted[item.name] = item;
+        file << "name,count,total_ms,mean_us,min_us,p50_us,p90_us,p99_us,p99.9_us,max_us,stddev_us\n";
+        for (const auto& item : sorted)
+        {
+            const Stats& stats = item.second;
+            const Latency_Histogram& histogram = stats.histogram;
+            file << csv_escape(stats.name) << "," << stats.count << "," << stats.total_ms << "," << stats.total_ms * 1e3 / stats.count
+                << "," << stats.min_us << "," << histogram.percentile(50) * 1e-3 << "," << histogram.percentile(90) * 1e-3
+                << "," << histogram.percentile(99) * 1e-3 << "," << histogram.percentile(99.9) * 1e-3
+                << "," << stats.max_us << "," << histogram.stddev() * 1e-3 << "\n";
+        }
+        return file.good();
+    }
+
+    // allocates the chunks for num_events events per thread, in every buffer now and in the ones created later,
+    // so recording stays free of allocations until that many events. reset() keeps the chunks
+    void reserve(const size_t num_events)
+    {
+        std::lock_guard<std::mutex> lck(_buffers_mutex);
+        _reserved_events = num_events;
+        for (auto& buffer : _buffers) buffer->reserve(num_events);
+    }
+
+    // drops every recorded event, only while no thread is inside a scope
+    void reset()
+    {
+        std::lock_guard<std::mutex> lck(_buffers_mutex);
+        for (auto& buffer : _buffers) buffer->count.store(0, std::memory_order_release);
+    }
+
+    void print_duration() const
+    {
+        std::map<std::string, Stats> sorted;
+        for (const auto& item : collect()) sorted[item.name] = item;
+
+        std::cout << "Time in ms (" << (Tsc_Clock::uses_tsc() ? "TSC" : "CLOCK_MONOTONIC") << ")" << std::endl;
+        std::cout
+            << std::left << std::setw(30) << "Bolck name"
+            << std::left << std::setw(20) << "Mean"
+            << std::left << std::setw(20) << "Min"
+            << std::left << std::setw(20) << "Max"
+            << std::left << std::setw(20) << "Total"
+            << std::left << std::setw(20) << "Cycles"
+            << Latency_Histogram::report_header()
+            << std::endl << std::endl;
+        for (const auto& item : sorted)
+        {
+            const Stats& stats = item.second;
+            std::cout
+                << std::left << std::setw(30) << stats.name
+                << std::left << std::setw(20) << stats.total_ms / stats.count
+                << std::left << std::setw(20) << stats.min_us * 1e-3
+                << std::left << std::setw(20) << stats.max_us * 1e-3
+                << std::left << std::setw(20) << stats.total_ms
+                << std::left << std::setw(20) << stats.count
+                << stats.histogram.report_columns()
+                << std::endl;
+        }
+    }
+
+    ~Fast_Timer() {}
+private:
+    static const size_t chunk_size = 4096;
+    static const size_t max_chunks = 4096;
+
+    struct Open_Scope
+    {
+        uint32_t name_id;
+        uint64_t start;
+    };
+
+    // written by its own thread only, readers see events up to the count published with release
+    struct Thread_Buffer
+    {
+        Thread_Buffer()
+        {
+            for (auto& chunk : chunks) chunk.store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~Thread_Buffer()
+        {
+            for (auto& chunk : chunks) delete[] chunk.load(std::memory_order_relaxed);
+        }
+
+        void append(const Event& event)
+        {
+            const size_t index = count.load(std::memory_order_relaxed);
+            const size_t chunk_index = index / chunk_size;
+            if (chunk_index >= max_chunks) return;
+            Event* chunk = chunks[chunk_index].load(std::memory_order_acquire);
+            if (chunk == nullptr) chunk = make_chunk(chunk_index);
+            chunk[index % chunk_size] = event;
+            count.store(index + 1, std::memory_order_release);
+        }
+
+        // only below the published count
+        const Event& event(const size_t index) const
+        {
+            return chunks[index / chunk_size].load(std::memory_order_relaxed)[index % chunk_size];
+        }
+
+        void reserve(const size_t num_events)
+        {
+            const size_t num_chunks = (num_events + chunk_size - 1) / chunk_size;
+            for (size_t c = 0; c < num_chunks && c < max_chunks; c++)
+            {
+                if (chunks[c].load(std::memory_order_acquire) == nullptr) make_chunk(c);
+            }
+        }
+
+        // reserve() runs on other threads, whoever installs the chunk first wins and the other copy is freed
+        Event* make_chunk(const size_t chunk_index)
+        {
+            Event* chunk = new Event[chunk_size];
+            Event* expected = nullptr;
+            if (chunks[chunk_index].compare_exchange_strong(expected, chunk, std::memory_order_acq_rel))
+            {
+                return chunk;
+            }
+            delete[] chunk;
+            return expected;
+        }
+
+        std::atomic<size_t> count{0};
+        std::atomic<Event*> chunks[max_chunks];
+        unsigned int depth = 0;
+        Open_Scope open[max_depth];
+        std::string name;   // track name, guarded by _buffers_mutex
+    };
+
+    Fast_Timer() {}
+
+    static Thread_Buffer*& tls_buffer()
+    {
+        static thread_local Thread_Buffer* buffer = nullptr;
+        return buffer;
+    }
+
+    // kept apart from the buffer, naming a thread that never records does not create one
+    static std::string& tls_thread_name()
+    {
+        static thread_local std::string name;
+        return name;
+    }
+
+    // buffers outlive their threads, so events of finished pool workers can still be read
+    Thread_Buffer& thread_buffer()
+    {
+        Thread_Buffer*& buffer = tls_buffer();
+        if (buffer == nullptr)
+        {
+            std::lock_guard<std::mutex> lck(_buffers_mutex);
+            _buffers.emplace_back(new Thread_Buffer());
+            buffer = _buffers.back().get();
+            buffer->name = tls_thread_name();
+            buffer->reserve(_reserved_events);
+        }
+        return *buffer;
+    }
+
+    std::vector<std::string> name_snapshot() const
+    {
+        std::lock_guard<std::mutex> lck(_names_mutex);
+        return _names;
+    }
+
+    static std::string json_escape(const std::string& text)
+    {
+        std::string escaped;
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                const char* const hex = "0123456789abcdef";
+                escaped += "\\u00";
+                escaped += hex[(c >> 4) & 0xf];
+                escaped += hex[c & 0xf];
+            }
+            else escaped += c;
+        }
+        return escaped;
+    }
+
+    // quoted only when needed, embedded quotes doubled
+    static std::string csv_escape(const std::string& text)
+    {
+        if (text.find_first_of(",\"\n") == std::string::npos) return text;
+        std::string escaped = "\"";
+        for (const char c : text)
+        {
+            if (c == '"') escaped += '"';
+            escaped += c;
+        }
+        return escaped + "\"";
+    }
+
+    mutable std::mutex _names_mutex;
+    std::vector<std::string> _names;
+    std::unordered_map<std::string, uint32_t> _name_ids;
+
+    mutable std::mutex _buffers_mutex;
+    std::vector<std::unique_ptr<Thread_Buffer>> _buffers;
+    size_t _reserved_events = 0;
+};
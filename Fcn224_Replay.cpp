@@ -0,0 +1,172 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Thread_Pool.hpp"
+#include "Argmax_Simd.hpp"
+#include "Tools.hpp"
+#include "Utils.hpp"
+#include "Latency_Histogram.hpp"
+
+#ifndef FCN224_DATA_DIR
+#define FCN224_DATA_DIR "fcn224_data"
+#endif
+
+// replays the recorded FCN224 layer 62 logits (1, 28, 28, 21) through every argmax + upsample variant and checks
+// each frame against the recorded layer 64 class map (1, 224, 224, 1, 1) :
+//     fcn224_replay [--data dir] [--frames n] [--rate fps] [--threads n]
+// frames are released at rate per second (0 runs flat out) and the latency of a frame runs from its release to the
+// end of the kernel, so a variant that falls behind the rate shows it in the tail. exit code 1 when an exact variant
+// differs from the recording on any frame, 2 on bad arguments or missing data
+
+struct Replay_Options
+{
+    std::string data_dir = FCN224_DATA_DIR;
+    unsigned int frames = 2000;
+    double rate = 0.0;
+    unsigned int threads = 0;
+};
+
+struct Replay_Variant
+{
+    std::string name;
+    bool exact;                     // nearest-neighbour variants reproduce the recording, bilinear only agrees with it
+    std::function<void()> run;
+};
+
+static bool parse_options(const int argc, char** argv, Replay_Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* const value = argv[++i];
+        if (arg == "--data") options.data_dir = value;
+        else if (arg == "--frames") options.frames = (unsigned int)std::strtoul(value, nullptr, 10);
+        else if (arg == "--rate") options.rate = std::strtod(value, nullptr);
+        else if (arg == "--threads") options.threads = (unsigned int)std::strtoul(value, nullptr, 10);
+        else return false;
+    }
+    return options.frames > 0 && options.rate >= 0.0;
+}
+
+int main(int argc, char** argv)
+{
+    Replay_Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << "usage : " << argv[0] << " [--data dir] [--frames n] [--rate fps] [--threads n]\n";
+        return 2;
+    }
+
+    std::vector<int8_t> tensor;
+    unsigned int num_columns = 0;
+    unsigned int num_rows = 0;
+    unsigned int num_filters = 0;
+    std::vector<int8_t> expected;
+    unsigned int scaled_up_num_columns = 0;
+    unsigned int scaled_up_num_rows = 0;
+    unsigned int expected_channels = 0;
+    if (!vector_populator(options.data_dir + "/o_62.txt", tensor, num_columns, num_rows, num_filters) ||
+        !vector_populator(options.data_dir + "/o_64.txt", expected, scaled_up_num_columns, scaled_up_num_rows, expected_channels))
+    {
+        return 2;
+    }
+    if (expected_channels != 1 || scaled_up_num_rows % num_rows != 0 || scaled_up_num_columns % num_columns != 0 ||
+        scaled_up_num_rows / num_rows != scaled_up_num_columns / num_columns)
+    {
+        std::cerr << "Recorded layers do not form an integer upsample\n";
+        return 2;
+    }
+    const unsigned int scale_up_factor = scaled_up_num_rows / num_rows;
+    const unsigned int mat_size = num_rows * num_columns;
+    const unsigned int scaled_up_mat_size = scaled_up_num_rows * scaled_up_num_columns;
+
+    obj_detect::Thread_Pool thread_pool(options.threads, obj_detect::Scheduler::lock_free_queue, obj_detect::Idle_Policy::spin_then_park);
+    const Upsample_Plan upsample_plan = make_upsample_plan(num_rows, num_columns, scaled_up_num_rows, scaled_up_num_columns);
+    const Bilinear_Plan bilinear_plan = make_bilinear_plan(num_rows, num_columns, scaled_up_num_rows, scaled_up_num_columns);
+    std::vector<int8_t> mat(mat_size);
+    std::vector<int8_t> scaled_up_mat(scaled_up_mat_size);
+    std::vector<int8_t> scaled_up_value(scaled_up_mat_size);
+    std::vector<uint8_t> scaled_up_margin(scaled_up_mat_size);
+
+    const std::vector<Replay_Variant> variants = {
+        {"argmax->upsampler", true, [&](){
+            argmax_tensor(tensor.data(), mat.data(), num_filters, mat_size);
+            upsampler(mat.data(), scaled_up_mat.data(), num_rows, num_columns, 1, scale_up_factor);
+        }},
+        {"argmax SIMD->upsampler", true, [&](){
+            argmax_tensor_simd(tensor.data(), mat.data(), num_filters, mat_size);
+            upsampler(mat.data(), scaled_up_mat.data(), num_rows, num_columns, 1, scale_up_factor);
+        }},
+        {"argmax MT->upsampler MT", true, [&](){
+            argmax_tensor_mt(tensor.data(), mat.data(), num_filters, mat_size, thread_pool, obj_detect::Partition::dynamic, num_columns);
+            upsampler_mt(mat.data(), scaled_up_mat.data(), upsample_plan, 1, thread_pool);
+        }},
+        {"argmax->up scale fused MT", true, [&](){
+            argmax_up_scale_mt(tensor.data(), scaled_up_mat.data(), num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+        }},
+        {"top2->up scale fused MT", true, [&](){
+            argmax_top2_up_scale_mt(tensor.data(), scaled_up_mat.data(), scaled_up_value.data(), scaled_up_margin.data(),
+                num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+        }},
+        {"bilinear->argmax fused MT", false, [&](){
+            bilinear_argmax_mt(tensor.data(), scaled_up_mat.data(), bilinear_plan, num_filters, thread_pool);
+        }}};
+
+    typedef std::chrono::steady_clock clock_type;
+    std::cout << "Replaying " << options.frames << " frames of " << num_rows << "x" << num_columns << "x" << num_filters
+        << " -> " << scaled_up_num_rows << "x" << scaled_up_num_columns << " at "
+        << (options.rate > 0.0 ? std::to_string(options.rate) + " fps" : std::string("full speed"))
+        << " on " << thread_pool.get_num_threads() << " threads, latencies in ms" << std::endl << std::endl;
+    std::cout << std::left << std::setw(30) << "Variant"
+        << std::left << std::setw(14) << "Frames/s"
+        << std::left << std::setw(20) << "Mismatched frames"
+        << std::left << std::setw(14) << "Agreement %"
+        << Latency_Histogram::report_header() << std::endl << std::endl;
+
+    bool failed = false;
+    for (const auto& variant : variants)
+    {
+        // one untimed frame so first touch and plan setup stay out of the numbers
+        variant.run();
+        Latency_Histogram latency;
+        unsigned int mismatched_frames = 0;
+        size_t mismatched_cells = 0;
+        const auto start = clock_type::now();
+        for (unsigned int i = 0; i < options.frames; i++)
+        {
+            // stale output from the previous frame must not pass the check
+            memset(scaled_up_mat.data(), -1, scaled_up_mat.size());
+            auto release = clock_type::now();
+            if (options.rate > 0.0)
+            {
+                release = start + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(i / options.rate));
+                while (clock_type::now() < release) std::this_thread::yield();
+            }
+            variant.run();
+            latency.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - release).count());
+
+            if (memcmp(scaled_up_mat.data(), expected.data(), scaled_up_mat_size) == 0) continue;
+            mismatched_frames++;
+            for (unsigned int c = 0; c < scaled_up_mat_size; c++) mismatched_cells += scaled_up_mat[c] != expected[c];
+        }
+        const double elapsed_s = std::chrono::duration<double>(clock_type::now() - start).count();
+        const double agreement = 100.0 - 100.0 * mismatched_cells / ((double)scaled_up_mat_size * options.frames);
+        failed = failed || (variant.exact && mismatched_frames > 0);
+
+        std::cout << std::left << std::setw(30) << variant.name
+            << std::left << std::setw(14) << options.frames / elapsed_s
+            << std::left << std::setw(20) << mismatched_frames
+            << std::left << std::setw(14) << agreement
+            << latency.report_columns() << std::endl;
+    }
+    if (failed) std::cerr << "An exact variant does not reproduce " << options.data_dir << "/o_64.txt\n";
+    return failed ? 1 : 0;
+}
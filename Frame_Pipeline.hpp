@@ -0,0 +1,232 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+
+#include "Thread_Pool.hpp"
+#include "Mpmc_Queue.hpp"
+#include "Probe.hpp"
+
+namespace obj_detect
+{
+    // what push() does when every frame slot is in flight
+    enum class Overflow_Policy
+    {
+        backpressure,   // the caller helps the pool until a slot is released
+        drop_oldest     // the oldest frame still waiting for a stage is discarded and its slot reused
+    };
+
+    // streaming pipeline over a fixed set of preallocated frame slots.
+    // every stage runs its frames one at a time and in push order, different stages overlap on the pool.
+    // stages are connected by bounded lock-free rings of slot indices, sized so a push between stages never fails,
+    // the slot count is what bounds the frames in flight.
+    template <typename Frame>
+    class Frame_Pipeline
+    {
+    public:
+        typedef std::function<void(Frame& frame, const uint64_t frame_id)> Stage_Fn;
+
+        struct Stage_Stats
+        {
+            std::string name;
+            uint64_t frames;
+            double busy_ms;     // time spent inside the stage function, frames / busy_ms is the stage capacity
+        };
+
+        Frame_Pipeline(Thread_Pool& thread_pool, const unsigned int num_slots, const Overflow_Policy policy = Overflow_Policy::backpressure, const unsigned int latency_capacity = 4096) :
+            _thread_pool(thread_pool), _task_group(thread_pool), _policy(policy), _slots(num_slots > 0 ? num_slots : 1),
+            _ring_capacity_log2(ring_capacity_log2(num_slots > 0 ? num_slots : 1)), _free_slots(_ring_capacity_log2),
+            _next_frame_id(0), _num_in_flight(0), _num_completed(0), _num_dropped(0), _latencies_us(latency_capacity > 0 ? latency_capacity : 1, 0.0)
+        {
+            for (unsigned int i = 0; i < _slots.size(); i++) _free_slots.try_push(i);
+        }
+
+        Frame_Pipeline(const Frame_Pipeline&) = delete;
+
+        // lets the caller preallocate the buffers of every slot before the first push
+        template <typename F>
+        void for_each_frame(F&& init)
+        {
+            for (auto& slot : _slots) init(slot.frame);
+        }
+
+        // stages must all be added before the first push
+        void add_stage(const std::string& name, Stage_Fn work)
+        {
+            _stages.emplace_back(new Stage(name, std::move(work), _ring_capacity_log2));
+        }
+
+        // starts a new frame at the first stage, false if an older frame was dropped to make room for it.
+        // frames are numbered by push(), so it is called from one thread
+        bool push()
+        {
+            bool dropped = false;
+            unsigned int slot_index = 0;
+            while (!_free_slots.try_pop(slot_index))
+            {
+                if (_policy == Overflow_Policy::drop_oldest && drop_oldest(slot_index))
+                {
+                    dropped = true;
+                    break;
+                }
+                if (!_thread_pool.run_pending_task()) std::this_thread::yield();
+            }
+            if (!dropped) _num_in_flight++;
+
+            Slot& slot = _slots[slot_index];
+            slot.frame_id = _next_frame_id++;
+            slot.pushed = clock_type::now();
+            enqueue(0, slot_index);
+            return !dropped;
+        }
+
+        // waits until every pushed frame has left the pipeline, running pool work meanwhile
+        void flush()
+        {
+            while (_num_in_flight > 0)
+            {
+                if (!_thread_pool.run_pending_task()) std::this_thread::yield();
+            }
+            _task_group.wait();
+        }
+
+        std::vector<Stage_Stats> get_stage_stats() const
+        {
+            std::vector<Stage_Stats> stats;
+            for (const auto& stage : _stages)
+            {
+                stats.push_back({stage->name, stage->frames.load(std::memory_order_relaxed), stage->busy_ns.load(std::memory_order_relaxed) / 1e6});
+            }
+            return stats;
+        }
+
+        uint64_t get_num_pushed() const { return _next_frame_id; }
+
+        uint64_t get_num_completed() const { return _num_completed; }
+
+        uint64_t get_num_dropped() const { return _num_dropped; }
+
+        // push to sink latency percentile in microseconds over the last latency_capacity completed frames, call after flush()
+        double latency_percentile(const double percentile) const
+        {
+            const size_t count = std::min<size_t>(_num_completed, _latencies_us.size());
+            if (count == 0) return 0.0;
+            std::vector<double> latencies(_latencies_us.begin(), _latencies_us.begin() + count);
+            const size_t rank = std::min(count - 1, (size_t)(percentile / 100.0 * count));
+            std::nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+            return latencies[rank];
+        }
+
+        ~Frame_Pipeline()
+        {
+            flush();
+        }
+    private:
+        typedef std::chrono::steady_clock clock_type;
+
+        struct Slot
+        {
+            Frame frame;
+            uint64_t frame_id = 0;
+            clock_type::time_point pushed;
+        };
+
+        struct Stage
+        {
+            Stage(const std::string& stage_name, Stage_Fn stage_work, const unsigned int capacity_log2) :
+                name(stage_name), probe_id(probe_name_id(stage_name)), work(std::move(stage_work)), input(capacity_log2), pending(0), frames(0), busy_ns(0) {}
+
+            std::string name;
+            uint32_t probe_id;          // the stage shows up under its own name in the exported trace
+            Stage_Fn work;
+            Mpmc_Queue<unsigned int> input;
+            std::atomic_uint pending;   // pushes not yet matched by a pop attempt, the drain task runs while it is non-zero
+            std::atomic<uint64_t> frames;
+            std::atomic<uint64_t> busy_ns;
+        };
+
+        static unsigned int ring_capacity_log2(const unsigned int num_slots)
+        {
+            unsigned int capacity_log2 = 1;
+            while (((size_t)1 << capacity_log2) < num_slots) capacity_log2++;
+            return capacity_log2;
+        }
+
+        // whoever moves pending off zero owns the stage until it drops back to zero, so a stage never runs twice at once
+        void enqueue(const unsigned int stage_index, unsigned int slot_index)
+        {
+            Stage& stage = *_stages[stage_index];
+            stage.input.try_push(slot_index);
+            if (stage.pending.fetch_add(1) == 0)
+            {
+                _task_group.run([this, stage_index]() { drain(stage_index); });
+            }
+        }
+
+        // a pop can come back empty when drop_oldest took the frame, the count still goes down by one
+        void drain(const unsigned int stage_index)
+        {
+            Stage& stage = *_stages[stage_index];
+            do
+            {
+                unsigned int slot_index = 0;
+                if (!stage.input.try_pop(slot_index)) continue;
+                Slot& slot = _slots[slot_index];
+                const auto start = clock_type::now();
+                {
+                    PROBE_SCOPE_ID(stage.probe_id);
+                    stage.work(slot.frame, slot.frame_id);
+                }
+                const auto stop = clock_type::now();
+                stage.frames.fetch_add(1, std::memory_order_relaxed);
+                stage.busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count(), std::memory_order_relaxed);
+
+                if (stage_index + 1 < _stages.size())
+                {
+                    enqueue(stage_index + 1, slot_index);
+                    continue;
+                }
+                // only the last stage completes frames, so the latency ring has a single writer
+                _latencies_us[_num_completed % _latencies_us.size()] = std::chrono::duration<double, std::micro>(stop - slot.pushed).count();
+                _num_completed++;
+                _free_slots.try_push(slot_index);
+                _num_in_flight--;
+            } while (stage.pending.fetch_sub(1) > 1);
+        }
+
+        // frames move through the stages in order, so the first waiting frame found from the back is the oldest one
+        bool drop_oldest(unsigned int& slot_index)
+        {
+            for (size_t s = _stages.size(); s-- > 0;)
+            {
+                if (_stages[s]->input.try_pop(slot_index))
+                {
+                    _num_dropped++;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        Thread_Pool& _thread_pool;
+        Task_Group _task_group;
+        Overflow_Policy _policy;
+        std::vector<Slot> _slots;
+        unsigned int _ring_capacity_log2;
+        Mpmc_Queue<unsigned int> _free_slots;
+        std::vector<std::unique_ptr<Stage>> _stages;
+
+        uint64_t _next_frame_id;
+        std::atomic<uint64_t> _num_in_flight;
+        std::atomic<uint64_t> _num_completed;
+        std::atomic<uint64_t> _num_dropped;
+        std::vector<double> _latencies_us;
+    };
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// HDR-style log-linear histogram of durations in nanoseconds. every power of two is split into
+// 2^sub_bucket_bits linear buckets, so a recorded value is off by at most 1/32 (about 3%) at any magnitude,
+// with a fixed 1920 buckets covering all of uint64. min, max, mean and stddev are exact.
+// histograms of the same block from different threads or runs add up with merge()
+class Latency_Histogram
+{
+public:
+    static const unsigned int sub_bucket_bits = 5;
+    static const unsigned int sub_bucket_count = 1u << sub_bucket_bits;
+    static const unsigned int bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+    Latency_Histogram() :
+        _buckets(bucket_count, 0), _count(0), _min(0), _max(0), _sum(0.0), _sum_of_squares(0.0)
+    {
+    }
+
+    void record(const uint64_t value_ns)
+    {
+        _buckets[bucket_index(value_ns)]++;
+        _min = (_count == 0 || value_ns < _min) ? value_ns : _min;
+        _max = (_count == 0 || value_ns > _max) ? value_ns : _max;
+        _sum += (double)value_ns;
+        _sum_of_squares += (double)value_ns * (double)value_ns;
+        _count++;
+    }
+
+    void merge(const Latency_Histogram& other)
+    {
+        if (other._count == 0) return;
+        for (unsigned int i = 0; i < bucket_count; i++) _buckets[i] += other._buckets[i];
+        _min = (_count == 0 || other._min < _min) ? other._min : _min;
+        _max = (_count == 0 || other._max > _max) ? other._max : _max;
+        _sum += other._sum;
+        _sum_of_squares += other._sum_of_squares;
+        _count += other._count;
+    }
+
+    void reset()
+    {
+        *this = Latency_Histogram();
+    }
+
+    uint64_t count() const { return _count; }
+
+    uint64_t min() const { return _min; }
+
+    uint64_t max() const { return _max; }
+
+    double mean() const
+    {
+        return _count > 0 ? _sum / _count : 0.0;
+    }
+
+    double stddev() const
+    {
+        if (_count < 2) return 0.0;
+        const double mean_value = mean();
+        const double variance = _sum_of_squares / _count - mean_value * mean_value;
+        return variance > 0.0 ? std::sqrt(variance) : 0.0;
+    }
+
+    // smallest recorded value with at least percentile % of the values at or below it, to bucket precision
+    uint64_t percentile(const double percentile) const
+    {
+        if (_count == 0) return 0;
+        if (percentile <= 0.0) return _min;
+        if (percentile >= 100.0) return _max;
+        uint64_t rank = (uint64_t)std::ceil(percentile / 100.0 * _count);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (unsigned int i = 0; i < bucket_count; i++)
+        {
+            seen += _buckets[i];
+            if (seen < rank) continue;
+            // the middle of the bucket, kept inside the exact range
+            const uint64_t value = bucket_lower_bound(i) + (bucket_width(i) - 1) / 2;
+            return value < _min ? _min : (value > _max ? _max : value);
+        }
+        return _max;
+    }
+
+    // one line of "count min max sum sum_of_squares" followed by "index count" pairs of the non-empty buckets
+    void save(std::ostream& stream) const
+    {
+        stream.precision(17);
+        stream << _count << " " << _min << " " << _max << " " << _sum << " " << _sum_of_squares;
+        for (unsigned int i = 0; i < bucket_count; i++)
+        {
+            if (_buckets[i] != 0) stream << " " << i << " " << _buckets[i];
+        }
+        stream << "\n";
+    }
+
+    // reads one line written by save() and merges it in, false on a malformed line
+    bool load(std::istream& stream)
+    {
+        std::string line;
+        if (!std::getline(stream, line)) return false;
+        Latency_Histogram loaded;
+        const char* cptr = line.c_str();
+        char* next = nullptr;
+        loaded._count = std::strtoull(cptr, &next, 10);
+        loaded._min = std::strtoull(next, &next, 10);
+        loaded._max = std::strtoull(next, &next, 10);
+        loaded._sum = std::strtod(next, &next);
+        loaded._sum_of_squares = std::strtod(next, &next);
+        uint64_t bucket_total = 0;
+        while (true)
+        {
+            char* after_index = nullptr;
+            const unsigned long long index = std::strtoull(next, &after_index, 10);
+            if (after_index == next) break;
+            char* after_count = nullptr;
+            const unsigned long long bucket = std::strtoull(after_index, &after_count, 10);
+            if (after_count == after_index || index >= bucket_count) return false;
+            loaded._buckets[index] += bucket;
+            bucket_total += bucket;
+            next = after_count;
+        }
+        if (bucket_total != loaded._count) return false;
+        merge(loaded);
+        return true;
+    }
+
+    // tail latency columns in ms, shared by the timer reports
+    static std::string report_header()
+    {
+        std::ostringstream stream;
+        for (const char* column : {"Min", "P50", "P90", "P99", "P99.9", "Max", "Stddev"})
+        {
+            stream << std::left << std::setw(12) << column;
+        }
+        return stream.str();
+    }
+
+    std::string report_columns() const
+    {
+        std::ostringstream stream;
+        stream.precision(4);
+        for (const double value : {(double)min(), (double)percentile(50), (double)percentile(90),
+            (double)percentile(99), (double)percentile(99.9), (double)max(), stddev()})
+        {
+            stream << std::left << std::setw(12) << value * 1e-6;
+        }
+        return stream.str();
+    }
+
+    static unsigned int bucket_index(const uint64_t value)
+    {
+        if (value < sub_bucket_count) return (unsigned int)value;
+#if defined(__GNUC__) || defined(__clang__)
+        const unsigned int msb = 63 - (unsigned int)__builtin_clzll(value);
+#else
+        unsigned int msb = 0;
+        while ((value >> msb) > 1) msb++;
+#endif
+        const unsigned int shift = msb - sub_bucket_bits;
+        return ((shift + 1) << sub_bucket_bits) | (unsigned int)((value >> shift) & (sub_bucket_count - 1));
+    }
+
+    static uint64_t bucket_lower_bound(const unsigned int index)
+    {
+        if (index < sub_bucket_count) return index;
+        const unsigned int shift = (index >> sub_bucket_bits) - 1;
+        return (uint64_t)((index & (sub_bucket_count - 1)) | sub_bucket_count) << shift;
+    }
+
+    static uint64_t bucket_width(const unsigned int index)
+    {
+        return index < sub_bucket_count ? 1 : (uint64_t)1 << ((index >> sub_bucket_bits) - 1);
+    }
+private:
+    std::vector<uint64_t> _buckets;
+    uint64_t _count;
+    uint64_t _min;
+    uint64_t _max;
+    double _sum;
+    double _sum_of_squares;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace obj_detect
+{
+    // bounded lock-free multi-producer multi-consumer ring buffer (Vyukov).
+    // every cell carries a sequence number telling producers and consumers whose turn it is,
+    // try_push fails when the ring is full and try_pop when it is empty, neither ever blocks or allocates.
+    template <typename T>
+    class Mpmc_Queue
+    {
+    public:
+        Mpmc_Queue(const unsigned int capacity_log2 = 10) :
+            _mask(((size_t)1 << capacity_log2) - 1), _buffer((size_t)1 << capacity_log2), _enqueue_pos(0), _dequeue_pos(0)
+        {
+            for (size_t i = 0; i <= _mask; i++) _buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        Mpmc_Queue(const Mpmc_Queue&) = delete;
+
+        // item is only moved from on success
+        bool try_push(T& item)
+        {
+            Cell* cell;
+            size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+            while (true)
+            {
+                cell = &_buffer[pos & _mask];
+                const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+                if (diff == 0)
+                {
+                    if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                }
+                else if (diff < 0) return false;
+                else pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+            cell->data = std::move(item);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool try_pop(T& item)
+        {
+            Cell* cell;
+            size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+            while (true)
+            {
+                cell = &_buffer[pos & _mask];
+                const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+                if (diff == 0)
+                {
+                    if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                }
+                else if (diff < 0) return false;
+                else pos = _dequeue_pos.load(std::memory_order_relaxed);
+            }
+            item = std::move(cell->data);
+            cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t capacity() const { return _mask + 1; }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+
+        const size_t _mask;
+        std::vector<Cell> _buffer;
+        alignas(64) std::atomic<size_t> _enqueue_pos;
+        alignas(64) std::atomic<size_t> _dequeue_pos;
+    };
+}
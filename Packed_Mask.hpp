@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// bit-packed class masks. pixel i takes bits [i * bits, (i + 1) * bits) of a little-endian bit stream, so every
+// group of 8 pixels fills exactly bits bytes and a pixel index that is a multiple of 8 starts on a byte.
+// bits can be 1 to 8, 4 bits hold 16 classes (half the bytes of an int8 mask) and 5 bits hold 32 (5/8 of them).
+// writers only touch the bytes of the pixels they write, so ranges that start and end on a multiple of 8 pixels
+// can be written from different threads
+
+// smallest bit width that holds class indices [0, num_classes), 0 when it does not fit in a byte
+inline unsigned int mask_bits_for_classes(const unsigned int num_classes)
+{
+    unsigned int bits = 1;
+    while(bits <= 8 && (1u << bits) < num_classes) bits++;
+    return bits <= 8 ? bits : 0;
+}
+
+inline size_t packed_mask_size(const size_t num_pixels, const unsigned int bits)
+{
+    return (num_pixels * bits + 7) / 8;
+}
+
+inline unsigned int packed_mask_get(const uint8_t* const packed_ptr, const size_t pixel, const unsigned int bits)
+{
+    const size_t bit = pixel * bits;
+    const unsigned int shift = (unsigned int)(bit & 7);
+    const uint8_t* const byte_cptr = packed_ptr + (bit >> 3);
+    unsigned int word = (unsigned int)byte_cptr[0] >> shift;
+    if(shift + bits > 8) word |= (unsigned int)byte_cptr[1] << (8 - shift);
+    return word & ((1u << bits) - 1);
+}
+
+inline void packed_mask_set(uint8_t* const packed_ptr, const size_t pixel, const unsigned int value, const unsigned int bits)
+{
+    const size_t bit = pixel * bits;
+    const unsigned int shift = (unsigned int)(bit & 7);
+    const unsigned int mask = (1u << bits) - 1;
+    const unsigned int word = value & mask;
+    uint8_t* const byte_cptr = packed_ptr + (bit >> 3);
+    byte_cptr[0] = (uint8_t)((byte_cptr[0] & ~(mask << shift)) | (word << shift));
+    if(shift + bits > 8) byte_cptr[1] = (uint8_t)((byte_cptr[1] & ~(mask >> (8 - shift))) | (word >> (8 - shift)));
+}
+
+// 8 byte indices of a little-endian word squeezed into its low 8 * bits bits, neighbouring fields are merged
+// pairwise, then by fours, then all eight
+inline uint64_t pack_group(uint64_t word, const unsigned int bits)
+{
+    word &= 0x0101010101010101ull * ((1u << bits) - 1);
+    word = (word & 0x00FF00FF00FF00FFull) | ((word & 0xFF00FF00FF00FF00ull) >> (8 - bits));
+    word = (word & 0x0000FFFF0000FFFFull) | ((word & 0xFFFF0000FFFF0000ull) >> (16 - 2 * bits));
+    return (word & 0x00000000FFFFFFFFull) | ((word & 0xFFFFFFFF00000000ull) >> (32 - 4 * bits));
+}
+
+// the inverse of pack_group, word holds 8 * bits bits and nothing above them
+inline uint64_t unpack_group(uint64_t word, const unsigned int bits)
+{
+    const uint64_t quad_mask = (1ull << (4 * bits)) - 1;
+    const uint64_t pair_mask = ((1ull << (2 * bits)) - 1) * 0x0000000100000001ull;
+    const uint64_t single_mask = ((1ull << bits) - 1) * 0x0001000100010001ull;
+    word = (word & quad_mask) | (((word >> (4 * bits)) & quad_mask) << 32);
+    word = (word & pair_mask) | (((word >> (2 * bits)) & pair_mask) << 16);
+    return (word & single_mask) | (((word >> bits) & single_mask) << 8);
+}
+
+// packs count class indices into pixels [first_pixel, first_pixel + count). whole groups of 8 are assembled in a
+// register and stored as bits bytes, byte sized indices are packed with a handful of word operations per group
+template <typename I>
+inline void pack_mask(const I* mask_ptr, uint8_t* const packed_ptr, size_t first_pixel, size_t count, const unsigned int bits)
+{
+    const uint64_t value_mask = (1u << bits) - 1;
+    for(; count > 0 && (first_pixel & 7) != 0; count--) packed_mask_set(packed_ptr, first_pixel++, (unsigned int)*mask_ptr++, bits);
+    uint8_t* group_cptr = packed_ptr + first_pixel / 8 * bits;
+    for(; count >= 8; count -= 8)
+    {
+        uint64_t group = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if(sizeof(I) == 1)
+        {
+            memcpy(&group, mask_ptr, 8);
+            group = pack_group(group, bits);
+            memcpy(group_cptr, &group, bits);
+            group_cptr += bits;
+            mask_ptr += 8;
+            continue;
+        }
+#endif
+        for(unsigned int k=0; k<8; k++) group |= ((uint64_t)mask_ptr[k] & value_mask) << (k * bits);
+        // little-endian byte order of the bit stream, whatever the host order
+        for(unsigned int b=0; b<bits; b++) group_cptr[b] = (uint8_t)(group >> (8 * b));
+        group_cptr += bits;
+        mask_ptr += 8;
+    }
+    first_pixel = (size_t)(group_cptr - packed_ptr) / bits * 8;
+    for(; count > 0; count--) packed_mask_set(packed_ptr, first_pixel++, (unsigned int)*mask_ptr++, bits);
+}
+
+template <typename I>
+inline void unpack_mask(const uint8_t* const packed_ptr, I* mask_ptr, size_t first_pixel, size_t count, const unsigned int bits)
+{
+    const uint64_t value_mask = (1u << bits) - 1;
+    for(; count > 0 && (first_pixel & 7) != 0; count--) *mask_ptr++ = (I)packed_mask_get(packed_ptr, first_pixel++, bits);
+    const uint8_t* group_cptr = packed_ptr + first_pixel / 8 * bits;
+    for(; count >= 8; count -= 8)
+    {
+        uint64_t group = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if(sizeof(I) == 1)
+        {
+            memcpy(&group, group_cptr, bits);
+            group = unpack_group(group, bits);
+            memcpy(mask_ptr, &group, 8);
+            group_cptr += bits;
+            mask_ptr += 8;
+            continue;
+        }
+#endif
+        for(unsigned int b=0; b<bits; b++) group |= (uint64_t)group_cptr[b] << (8 * b);
+        for(unsigned int k=0; k<8; k++) mask_ptr[k] = (I)((group >> (k * bits)) & value_mask);
+        group_cptr += bits;
+        mask_ptr += 8;
+    }
+    first_pixel = (size_t)(group_cptr - packed_ptr) / bits * 8;
+    for(; count > 0; count--) *mask_ptr++ = (I)packed_mask_get(packed_ptr, first_pixel++, bits);
+}
+
+// copies the packed row of row_size pixels starting at first_pixel over the num_copies rows that follow it,
+// with plain byte copies when the rows start on a byte
+inline void replicate_packed_row(uint8_t* const packed_ptr, const size_t first_pixel, const size_t row_size, const unsigned int num_copies, const unsigned int bits)
+{
+    if(((first_pixel * bits) & 7) == 0 && ((row_size * bits) & 7) == 0)
+    {
+        const size_t row_bytes = row_size * bits / 8;
+        uint8_t* const row_cptr = packed_ptr + first_pixel * bits / 8;
+        for(unsigned int i=1; i<=num_copies; i++) memcpy(row_cptr + i * row_bytes, row_cptr, row_bytes);
+        return;
+    }
+    const size_t block_size = 256;
+    uint8_t block[block_size];
+    for(size_t start=0; start<row_size; start+=block_size)
+    {
+        const size_t count = (row_size - start < block_size) ? row_size - start : block_size;
+        unpack_mask(packed_ptr, block, first_pixel + start, count, bits);
+        for(unsigned int i=1; i<=num_copies; i++) pack_mask(block, packed_ptr, first_pixel + i * row_size + start, count, bits);
+    }
+}
+
+// index of the first pixel where the packed mask and the unpacked one differ, num_pixels if they agree
+template <typename I>
+inline size_t packed_mask_mismatch(const uint8_t* const packed_ptr, const I* const mask_ptr, const size_t num_pixels, const unsigned int bits)
+{
+    const size_t block_size = 256;
+    I block[block_size];
+    for(size_t start=0; start<num_pixels; start+=block_size)
+    {
+        const size_t count = (num_pixels - start < block_size) ? num_pixels - start : block_size;
+        unpack_mask(packed_ptr, block, start, count, bits);
+        for(size_t i=0; i<count; i++)
+        {
+            if(block[i] != mask_ptr[start + i]) return start + i;
+        }
+    }
+    return num_pixels;
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if __linux__ == 1
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// user space hardware counters of the calling thread through perf_event_open, counting from open() on.
+// the hardware events share one group so they are read together in a single syscall, page faults is a
+// software event read on its own. events the cpu, the kernel or the container does not allow are skipped,
+// available() tells which ones are counted and error() why the others are not.
+// a block is measured as the difference of two read() snapshots, scaled up when the kernel multiplexed the group
+class Perf_Counters
+{
+public:
+    enum Counter
+    {
+        cycles,
+        instructions,
+        l1d_misses,     // L1 data cache read misses
+        llc_misses,     // last level cache misses
+        branch_misses,
+        page_faults,
+        num_counters
+    };
+
+    struct Snapshot
+    {
+        uint64_t value[num_counters] = {};
+        uint64_t time_enabled[num_counters] = {};
+        uint64_t time_running[num_counters] = {};
+    };
+
+    Perf_Counters()
+    {
+        for (auto& fd : _fds) fd = -1;
+    }
+
+    Perf_Counters(const Perf_Counters&) = delete;
+
+    static const char* name(const Counter counter)
+    {
+        static const char* const names[num_counters] = {"cycles", "instructions", "L1D misses", "LLC misses", "branch misses", "page faults"};
+        return names[counter];
+    }
+
+    // true if at least one counter could be opened
+    bool open()
+    {
+        close();
+        _error.clear();
+#if __linux__ == 1
+        for (unsigned int c = 0; c < num_counters; c++)
+        {
+            const Counter counter = (Counter)c;
+            const bool grouped = counter != page_faults;
+            const int group_fd = (grouped && _leader != num_counters) ? _fds[_leader] : -1;
+            _fds[c] = open_counter(counter, group_fd, grouped);
+            if (_fds[c] < 0)
+            {
+                if (_error.empty()) _error = std::string(name(counter)) + " : " + open_error(errno);
+                continue;
+            }
+            if (grouped && _leader == num_counters) _leader = c;
+            if (grouped) _group[_num_grouped++] = counter;
+        }
+#else
+        _error = "perf_event_open is linux only";
+#endif
+        return is_open();
+    }
+
+    void close()
+    {
+#if __linux__ == 1
+        for (auto& fd : _fds)
+        {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+#endif
+        _leader = num_counters;
+        _num_grouped = 0;
+    }
+
+    bool is_open() const
+    {
+        for (const int fd : _fds)
+        {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    bool available(const Counter counter) const
+    {
+        return _fds[counter] >= 0;
+    }
+
+    // first reason a counter could not be opened, empty when every counter is counted
+    const std::string& error() const
+    {
+        return _error;
+    }
+
+    // current totals, two syscalls at most
+    bool read(Snapshot& snapshot) const
+    {
+#if __linux__ == 1
+        if (_leader != num_counters)
+        {
+            // PERF_FORMAT_GROUP layout : nr, time_enabled, time_running, one value per member in opening order
+            uint64_t buffer[3 + num_counters];
+            if (::read(_fds[_leader], buffer, sizeof(buffer)) < (ssize_t)(3 * sizeof(uint64_t))) return false;
+            for (unsigned int i = 0; i < buffer[0] && i < _num_grouped; i++)
+            {
+                snapshot.value[_group[i]] = buffer[3 + i];
+                snapshot.time_enabled[_group[i]] = buffer[1];
+                snapshot.time_running[_group[i]] = buffer[2];
+            }
+        }
+        if (_fds[page_faults] >= 0)
+        {
+            uint64_t buffer[3];
+            if (::read(_fds[page_faults], buffer, sizeof(buffer)) != (ssize_t)sizeof(buffer)) return false;
+            snapshot.value[page_faults] = buffer[0];
+            snapshot.time_enabled[page_faults] = buffer[1];
+            snapshot.time_running[page_faults] = buffer[2];
+        }
+        return true;
+#else
+        (void)snapshot;
+        return false;
+#endif
+    }
+
+    // events counted between two snapshots, extrapolated over the time the counter was not scheduled
+    static double difference(const Snapshot& first, const Snapshot& second, const Counter counter)
+    {
+        const double value = (double)(second.value[counter] - first.value[counter]);
+        const uint64_t enabled = second.time_enabled[counter] - first.time_enabled[counter];
+        const uint64_t running = second.time_running[counter] - first.time_running[counter];
+        return (running > 0 && running < enabled) ? value * enabled / running : value;
+    }
+
+    ~Perf_Counters()
+    {
+        close();
+    }
+private:
+#if __linux__ == 1
+    static int open_counter(const Counter counter, const int group_fd, const bool grouped)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING | (grouped ? PERF_FORMAT_GROUP : 0);
+        switch (counter)
+        {
+        case cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case l1d_misses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case llc_misses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case branch_misses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        default:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+            break;
+        }
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+    }
+
+    static std::string open_error(const int error)
+    {
+        if (error == EACCES || error == EPERM) return "not permitted, see /proc/sys/kernel/perf_event_paranoid or the container seccomp profile";
+        if (error == ENOENT || error == EOPNOTSUPP) return "not supported by this cpu or hypervisor";
+        if (error == ENOSYS) return "perf_event_open not available";
+        return strerror(error);
+    }
+#endif
+
+    int _fds[num_counters];
+    unsigned int _leader = num_counters;    // first hardware counter opened, reads the whole group
+    Counter _group[num_counters] = {};      // hardware counters in group order
+    unsigned int _num_grouped = 0;
+    std::string _error;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+// scoped timing probes meant to stay in the kernels of production builds.
+//     PROBE_SCOPE("argmax_tensor_mt");
+// times the rest of the enclosing block into Fast_Timer. the name is a string literal interned once per call site
+// into a function-local static id, so the hot path is an enabled check, two clock reads and an append into the
+// thread's preallocated event buffer, with no string and no heap allocation.
+// names only known at run time (pipeline stages) are registered once with probe_name_id() and timed with
+// PROBE_SCOPE_ID(id), and PROBE_THREAD_NAME(name) names the calling thread's track in the exported trace.
+// probes record nothing until Probe::enable(true), and building with OBJ_DETECT_INSTRUMENTATION=0 removes them
+// completely, Fast_Timer is not even included then.
+#ifndef OBJ_DETECT_INSTRUMENTATION
+#define OBJ_DETECT_INSTRUMENTATION 1
+#endif
+
+#if OBJ_DETECT_INSTRUMENTATION == 1
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "Fast_Timer.hpp"
+
+class Probe
+{
+public:
+    explicit Probe(const uint32_t name_id) :
+        _active(_enabled.load(std::memory_order_relaxed))
+    {
+        if (_active) Fast_Timer::Get().start(name_id);
+    }
+
+    Probe(const Probe&) = delete;
+
+    // a probe that was entered while enabled always closes its scope, so toggling never unbalances the stack
+    ~Probe()
+    {
+        if (_active) Fast_Timer::Get().stop();
+    }
+
+    static void enable(const bool enabled)
+    {
+        _enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    static bool enabled()
+    {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+private:
+    const bool _active;
+    static inline std::atomic_bool _enabled{false};
+};
+
+inline uint32_t probe_name_id(const std::string& name)
+{
+    return Fast_Timer::Get().name_id(name);
+}
+
+#define PROBE_CONCAT_IMPL(a, b) a##b
+#define PROBE_CONCAT(a, b) PROBE_CONCAT_IMPL(a, b)
+
+#define PROBE_SCOPE(name) \
+    static const uint32_t PROBE_CONCAT(probe_id_, __LINE__) = Fast_Timer::Get().name_id(name); \
+    const Probe PROBE_CONCAT(probe_, __LINE__)(PROBE_CONCAT(probe_id_, __LINE__))
+
+#define PROBE_SCOPE_ID(name_id) const Probe PROBE_CONCAT(probe_, __LINE__)(name_id)
+
+#define PROBE_THREAD_NAME(name) Fast_Timer::Get().set_thread_name(name)
+
+#else
+
+#include <cstdint>
+#include <string>
+
+// callers can still toggle recording, there is nothing to record
+class Probe
+{
+public:
+    static void enable(const bool) {}
+
+    static bool enabled() { return false; }
+};
+
+inline uint32_t probe_name_id(const std::string&)
+{
+    return 0;
+}
+
+#define PROBE_SCOPE(name) do {} while (0)
+
+#define PROBE_SCOPE_ID(name_id) do {} while (0)
+
+#define PROBE_THREAD_NAME(name) do {} while (0)
+
+#endif
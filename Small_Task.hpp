@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace obj_detect
+{
+    // move-only void() callable stored inline, it never allocates.
+    // a capture that does not fit in capacity bytes is a compile error rather than a silent heap fallback.
+    class Small_Task
+    {
+    public:
+        static const size_t capacity = 48;
+
+        Small_Task() noexcept : _invoke(nullptr), _manage(nullptr) {}
+
+        template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Small_Task>::value>::type>
+        Small_Task(F&& work)
+        {
+            typedef typename std::decay<F>::type Fn;
+            static_assert(sizeof(Fn) <= capacity, "task capture is too large for Small_Task, capture a pointer to the state instead");
+            static_assert(alignof(Fn) <= alignof(std::max_align_t), "task capture is over-aligned for Small_Task");
+            new (&_storage) Fn(std::forward<F>(work));
+            _invoke = [](void* storage) { (*static_cast<Fn*>(storage))(); };
+            _manage = [](void* dst, void* src)
+            {
+                if (dst != nullptr) new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                static_cast<Fn*>(src)->~Fn();
+            };
+        }
+
+        Small_Task(Small_Task&& other) noexcept : _invoke(other._invoke), _manage(other._manage)
+        {
+            if (_manage != nullptr) _manage(&_storage, &other._storage);
+            other._invoke = nullptr;
+            other._manage = nullptr;
+        }
+
+        Small_Task& operator=(Small_Task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                _invoke = other._invoke;
+                _manage = other._manage;
+                if (_manage != nullptr) _manage(&_storage, &other._storage);
+                other._invoke = nullptr;
+                other._manage = nullptr;
+            }
+            return *this;
+        }
+
+        Small_Task(const Small_Task&) = delete;
+        Small_Task& operator=(const Small_Task&) = delete;
+
+        void operator()() { _invoke(&_storage); }
+
+        explicit operator bool() const { return _invoke != nullptr; }
+
+        void reset()
+        {
+            if (_manage != nullptr) _manage(nullptr, &_storage);
+            _invoke = nullptr;
+            _manage = nullptr;
+        }
+
+        ~Small_Task() { reset(); }
+
+    private:
+        alignas(std::max_align_t) unsigned char _storage[capacity];
+        void (*_invoke)(void* storage);
+        void (*_manage)(void* dst, void* src); // move-constructs src into dst when dst is set, then destroys src
+    };
+}
@@ -0,0 +1,17 @@
+#include "Utils.hpp"
+
+// converts text dumps to tensor files : tensor_convert o_62.txt o_62.bin [o_64.txt o_64.bin ...]
+int main(int argc, char** argv)
+{
+    if (argc < 3 || argc % 2 != 1)
+    {
+        std::cerr << "usage : " << argv[0] << " <dump.txt> <tensor.bin> [<dump.txt> <tensor.bin> ...]\n";
+        return 1;
+    }
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!convert_text_dump(argv[i], argv[i + 1])) return 1;
+        std::cout << argv[i] << " -> " << argv[i + 1] << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,456 @@
+#include "Tensor_File.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <charconv>
+
+#include "Thread_Pool.hpp"
+#include "Probe.hpp"
+
+#if __linux__ == 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const char tensor_file_magic[8] = {'O', 'D', 'T', 'E', 'N', 'S', 'O', 'R'};
+static const uint32_t tensor_file_version = 1;
+static const uint32_t tensor_file_max_alignment = 4096;
+
+size_t tensor_dtype_size(const Tensor_Dtype dtype)
+{
+    switch (dtype)
+    {
+    case Tensor_Dtype::int8:
+    case Tensor_Dtype::uint8: return 1;
+    case Tensor_Dtype::int16: return 2;
+    case Tensor_Dtype::int32:
+    case Tensor_Dtype::float32: return 4;
+    default: return 0;
+    }
+}
+
+// payload bytes of the header shape and dtype, false when the product does not fit in a size_t
+static bool data_size_of(const Tensor_File_Header& header, size_t& data_size)
+{
+    size_t count = 1;
+    for (unsigned int d = 0; d < header.rank; d++)
+    {
+        if (header.shape[d] != 0 && count > SIZE_MAX / header.shape[d]) return false;
+        count *= header.shape[d];
+    }
+    const size_t dtype_size = tensor_dtype_size((Tensor_Dtype)header.dtype);
+    if (dtype_size == 0 || count > SIZE_MAX / dtype_size) return false;
+    data_size = count * dtype_size;
+    return true;
+}
+
+bool write_tensor_file(
+    const std::string& path,
+    const void* data_ptr,
+    const Tensor_Dtype dtype,
+    const std::vector<uint32_t>& shape,
+    const Tensor_Layout layout,
+    const uint32_t alignment)
+{
+    if (shape.empty() || shape.size() > Tensor_File_Header::max_rank || tensor_dtype_size(dtype) == 0 ||
+        alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > tensor_file_max_alignment)
+    {
+        std::cerr << "Tensor file " << path << " : unsupported dtype, shape or alignment\n";
+        return false;
+    }
+
+    Tensor_File_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, tensor_file_magic, sizeof(header.magic));
+    header.version = tensor_file_version;
+    header.dtype = (uint32_t)dtype;
+    header.layout = (uint32_t)layout;
+    header.rank = (uint32_t)shape.size();
+    for (unsigned int d = 0; d < Tensor_File_Header::max_rank; d++) header.shape[d] = d < shape.size() ? shape[d] : 1;
+    header.alignment = alignment;
+    header.data_offset = (sizeof(header) + alignment - 1) / alignment * alignment;
+    size_t data_size = 0;
+    if (!data_size_of(header, data_size))
+    {
+        std::cerr << "Tensor file " << path << " : shape too large\n";
+        return false;
+    }
+    header.data_size = data_size;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Tensor file " << path << " : cannot open for writing\n";
+        return false;
+    }
+    const std::vector<char> padding(header.data_offset - sizeof(header), 0);
+    file.write((const char*)&header, sizeof(header));
+    file.write(padding.data(), padding.size());
+    file.write((const char*)data_ptr, header.data_size);
+    if (!file.good())
+    {
+        std::cerr << "Tensor file " << path << " : write failed\n";
+        return false;
+    }
+    return true;
+}
+
+// checks everything the loader relies on before any pointer into the file is handed out
+static bool header_valid(const Tensor_File_Header& header, const size_t file_size)
+{
+    if (memcmp(header.magic, tensor_file_magic, sizeof(header.magic)) != 0) return false;
+    if (header.version != tensor_file_version) return false;
+    if (tensor_dtype_size((Tensor_Dtype)header.dtype) == 0) return false;
+    if (header.layout > (uint32_t)Tensor_Layout::planar) return false;
+    if (header.rank == 0 || header.rank > Tensor_File_Header::max_rank) return false;
+    for (unsigned int d = header.rank; d < Tensor_File_Header::max_rank; d++)
+    {
+        if (header.shape[d] != 1) return false;
+    }
+    if (header.alignment == 0 || (header.alignment & (header.alignment - 1)) != 0 || header.alignment > tensor_file_max_alignment) return false;
+    if (header.data_offset < sizeof(header) || header.data_offset % header.alignment != 0) return false;
+    size_t data_size = 0;
+    if (!data_size_of(header, data_size) || header.data_size != data_size) return false;
+    return header.data_offset <= file_size && header.data_size <= file_size - header.data_offset;
+}
+
+// whole file mapped read-only (copied into a string where mmap is not available)
+class Mapped_File
+{
+public:
+    Mapped_File(const std::string& path) :
+        _data(nullptr), _size(0), _mapping(nullptr)
+    {
+#if __linux__ == 1
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+        {
+            void* mapping = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                _mapping = mapping;
+                _size = (size_t)file_stat.st_size;
+                _data = (const char*)mapping;
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return;
+        _buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        _data = _buffer.data();
+        _size = _buffer.size();
+#endif
+    }
+
+    Mapped_File(const Mapped_File&) = delete;
+
+    const char* data() const { return _data; }
+
+    size_t size() const { return _size; }
+
+    ~Mapped_File()
+    {
+#if __linux__ == 1
+        if (_mapping != nullptr) munmap(_mapping, _size);
+#endif
+    }
+private:
+    const char* _data;
+    size_t _size;
+    void* _mapping;
+    std::string _buffer;
+};
+
+static bool is_space(const char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// parses the values of [begin, end) into dst, at most capacity of them. the count goes past capacity
+// (without writing) so the caller can tell a long file from a short one, false on a malformed value
+static bool parse_values(const char* begin, const char* const end, int8_t* const dst, const size_t capacity, size_t& count)
+{
+    count = 0;
+    const char* cptr = begin;
+    while (true)
+    {
+        while (cptr < end && is_space(*cptr)) cptr++;
+        if (cptr == end) return true;
+
+        int value = 0;
+        const std::from_chars_result result = std::from_chars(cptr, end, value);
+        if (result.ec != std::errc() || value < -128 || value > 127) return false;
+        cptr = result.ptr;
+        // a fractional part is truncated, as the float to int8 conversion of the old loader did
+        if (cptr < end && *cptr == '.')
+        {
+            cptr++;
+            while (cptr < end && *cptr >= '0' && *cptr <= '9') cptr++;
+        }
+        if (cptr < end && !is_space(*cptr)) return false;
+
+        if (count < capacity) dst[count] = (int8_t)value;
+        count++;
+    }
+}
+
+// the shape is the comma separated list inside the first pair of parentheses of the header line
+static bool parse_header_shape(const char* begin, const char* const end, std::vector<uint32_t>& shape)
+{
+    const char* open = (const char*)memchr(begin, '(', end - begin);
+    if (open == nullptr) return false;
+    const char* close = (const char*)memchr(open, ')', end - open);
+    if (close == nullptr) return false;
+    const char* cptr = open + 1;
+    while (cptr < close)
+    {
+        while (cptr < close && (is_space(*cptr) || *cptr == ',')) cptr++;
+        if (cptr == close) break;
+        uint32_t dimension = 0;
+        const std::from_chars_result result = std::from_chars(cptr, close, dimension);
+        if (result.ec != std::errc() || shape.size() == Tensor_File_Header::max_rank) return false;
+        shape.push_back(dimension);
+        cptr = result.ptr;
+    }
+    return !shape.empty();
+}
+
+bool parse_text_dump(
+    const std::string& path,
+    std::vector<int8_t>& vec,
+    std::vector<uint32_t>& shape,
+    obj_detect::Thread_Pool* thread_pool,
+    const size_t parallel_min_bytes)
+{
+    PROBE_SCOPE("parse_text_dump");
+    vec.clear();
+    shape.clear();
+    const Mapped_File file(path);
+    if (file.data() == nullptr)
+    {
+        std::cerr << "Text dump " << path << " : not opened\n";
+        return false;
+    }
+    const char* const begin = file.data();
+    const char* const end = begin + file.size();
+    const char* header_end = (const char*)memchr(begin, '\n', end - begin);
+    if (header_end == nullptr) header_end = end;
+    if (!parse_header_shape(begin, header_end, shape))
+    {
+        std::cerr << "Text dump " << path << " : no shape in the header\n";
+        return false;
+    }
+    const char* const body = header_end;
+    const size_t body_size = end - body;
+    // every value takes at least two bytes, a shape the body cannot hold is rejected before anything is allocated
+    const size_t max_values = body_size / 2 + 1;
+    size_t expected = 1;
+    for (const uint32_t dimension : shape)
+    {
+        expected = (dimension == 0 || expected <= max_values / dimension) ? expected * dimension : max_values + 1;
+    }
+    if (expected > max_values)
+    {
+        std::cerr << "Text dump " << path << " : shape larger than the file\n";
+        shape.clear();
+        return false;
+    }
+    vec.resize(expected);
+
+    bool valid = true;
+    size_t count = 0;
+    if (thread_pool == nullptr || body_size < parallel_min_bytes || thread_pool->get_num_threads() < 2)
+    {
+        valid = parse_values(body, end, vec.data(), expected, count);
+    }
+    else
+    {
+        // chunks start after a line break, so no value is split, and each parses into its own buffer
+        // because its output offset is only known once the chunks before it are counted
+        const unsigned int num_chunks = thread_pool->get_num_threads() * 4;
+        std::vector<const char*> bounds(num_chunks + 1, end);
+        bounds[0] = body;
+        for (unsigned int i = 1; i < num_chunks; i++)
+        {
+            const char* cptr = body + body_size / num_chunks * i;
+            if (cptr < bounds[i - 1]) cptr = bounds[i - 1];
+            const char* line_break = (const char*)memchr(cptr, '\n', end - cptr);
+            bounds[i] = line_break != nullptr ? line_break : end;
+        }
+        std::vector<std::vector<int8_t>> chunk_values(num_chunks);
+        std::vector<size_t> chunk_counts(num_chunks, 0);
+        std::vector<char> chunk_valid(num_chunks, 1);
+        thread_pool->parallel_for(0, num_chunks, 1, [&](const unsigned int chunk_begin, const unsigned int chunk_end){
+            for (unsigned int i = chunk_begin; i < chunk_end; i++)
+            {
+                // a value takes at least two bytes (digit and line break), which bounds the count of a chunk
+                chunk_values[i].resize((bounds[i + 1] - bounds[i]) / 2 + 1);
+                chunk_valid[i] = parse_values(bounds[i], bounds[i + 1], chunk_values[i].data(), chunk_values[i].size(), chunk_counts[i]);
+            }
+        }, obj_detect::Partition::dynamic);
+        for (unsigned int i = 0; i < num_chunks && valid; i++)
+        {
+            valid = chunk_valid[i] != 0;
+            if (valid && count + chunk_counts[i] <= expected) memcpy(vec.data() + count, chunk_values[i].data(), chunk_counts[i]);
+            count += chunk_counts[i];
+        }
+    }
+
+    if (!valid || count != expected)
+    {
+        if (!valid) std::cerr << "Text dump " << path << " : malformed value\n";
+        else std::cerr << "Text dump " << path << " : " << count << " values for a shape of " << expected << "\n";
+        vec.clear();
+        shape.clear();
+        return false;
+    }
+    return true;
+}
+
+Mapped_Tensor::Mapped_Tensor() :
+    _mapping(nullptr), _mapping_size(0), _data(nullptr)
+{
+    memset(&_header, 0, sizeof(_header));
+}
+
+Mapped_Tensor::Mapped_Tensor(Mapped_Tensor&& other) :
+    Mapped_Tensor()
+{
+    *this = std::move(other);
+}
+
+Mapped_Tensor& Mapped_Tensor::operator=(Mapped_Tensor&& other)
+{
+    if (this == &other) return *this;
+    close();
+    _header = other._header;
+    _mapping = other._mapping;
+    _mapping_size = other._mapping_size;
+    _buffer = std::move(other._buffer);
+    _data = other._data;
+    other._mapping = nullptr;
+    other._mapping_size = 0;
+    other._data = nullptr;
+    memset(&other._header, 0, sizeof(other._header));
+    return *this;
+}
+
+bool Mapped_Tensor::open(const std::string& path)
+{
+    close();
+#if __linux__ == 1
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Tensor file " << path << " : not opened\n";
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size < sizeof(Tensor_File_Header))
+    {
+        std::cerr << "Tensor file " << path << " : too short\n";
+        ::close(fd);
+        return false;
+    }
+    const size_t file_size = (size_t)file_stat.st_size;
+    void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Tensor file " << path << " : mmap failed\n";
+        return false;
+    }
+    memcpy(&_header, mapping, sizeof(_header));
+    if (!header_valid(_header, file_size))
+    {
+        std::cerr << "Tensor file " << path << " : bad header\n";
+        munmap(mapping, file_size);
+        memset(&_header, 0, sizeof(_header));
+        return false;
+    }
+    _mapping = mapping;
+    _mapping_size = file_size;
+    _data = (const char*)mapping + _header.data_offset;
+    return true;
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        std::cerr << "Tensor file " << path << " : not opened\n";
+        return false;
+    }
+    const size_t file_size = (size_t)file.tellg();
+    file.seekg(0);
+    if (file_size < sizeof(Tensor_File_Header) || !file.read((char*)&_header, sizeof(_header)) || !header_valid(_header, file_size))
+    {
+        std::cerr << "Tensor file " << path << " : bad header\n";
+        memset(&_header, 0, sizeof(_header));
+        return false;
+    }
+    // uint64_t storage keeps the copy 8 byte aligned, the most any dtype needs
+    _buffer.resize((_header.data_size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    file.seekg(_header.data_offset);
+    file.read((char*)_buffer.data(), _header.data_size);
+    _data = _buffer.data();
+    return true;
+#endif
+}
+
+void Mapped_Tensor::close()
+{
+#if __linux__ == 1
+    if (_mapping != nullptr) munmap(_mapping, _mapping_size);
+#endif
+    _mapping = nullptr;
+    _mapping_size = 0;
+    _buffer.clear();
+    _data = nullptr;
+    memset(&_header, 0, sizeof(_header));
+}
+
+bool Mapped_Tensor::is_open() const
+{
+    return _data != nullptr;
+}
+
+const void* Mapped_Tensor::data() const
+{
+    return _data;
+}
+
+Tensor_Dtype Mapped_Tensor::dtype() const
+{
+    return (Tensor_Dtype)_header.dtype;
+}
+
+Tensor_Layout Mapped_Tensor::layout() const
+{
+    return (Tensor_Layout)_header.layout;
+}
+
+std::vector<uint32_t> Mapped_Tensor::shape() const
+{
+    return std::vector<uint32_t>(_header.shape, _header.shape + _header.rank);
+}
+
+size_t Mapped_Tensor::num_elements() const
+{
+    return is_open() ? (size_t)_header.data_size / tensor_dtype_size((Tensor_Dtype)_header.dtype) : 0;
+}
+
+size_t Mapped_Tensor::size_bytes() const
+{
+    return _header.data_size;
+}
+
+Mapped_Tensor::~Mapped_Tensor()
+{
+    close();
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Argmax_Simd.hpp"
+
+namespace obj_detect
+{
+    class Thread_Pool;
+}
+
+// element type of a tensor file
+enum class Tensor_Dtype : uint32_t
+{
+    int8 = 1,
+    uint8 = 2,
+    int16 = 3,
+    int32 = 4,
+    float32 = 5
+};
+
+size_t tensor_dtype_size(const Tensor_Dtype dtype);
+
+// fixed 72 byte little-endian header at the start of a tensor file, the data starts at data_offset,
+// which is a multiple of alignment so a mapped file hands out aligned pointers
+struct Tensor_File_Header
+{
+    static const unsigned int max_rank = 6;
+
+    char magic[8];                  // "ODTENSOR"
+    uint32_t version;
+    uint32_t dtype;                 // Tensor_Dtype
+    uint32_t layout;                // Tensor_Layout
+    uint32_t rank;
+    uint32_t shape[max_rank];       // outermost first, unused dimensions are 1
+    uint32_t alignment;             // power of two, at most the page size
+    uint32_t reserved;
+    uint64_t data_offset;
+    uint64_t data_size;             // in bytes
+};
+
+static_assert(sizeof(Tensor_File_Header) == 72, "tensor file header layout changed");
+
+// writes data with the given shape, false (with a message on stderr) if the file cannot be written
+bool write_tensor_file(
+    const std::string& path,
+    const void* data_ptr,
+    const Tensor_Dtype dtype,
+    const std::vector<uint32_t>& shape,
+    const Tensor_Layout layout = Tensor_Layout::channel_last,
+    const uint32_t alignment = 64);
+
+// read-only view of a tensor file. on linux the file is memory-mapped and data() points into the mapping,
+// nothing is copied or parsed beyond the header. elsewhere the data is read into an aligned buffer
+class Mapped_Tensor
+{
+public:
+    Mapped_Tensor();
+
+    Mapped_Tensor(const Mapped_Tensor&) = delete;
+
+    Mapped_Tensor(Mapped_Tensor&& other);
+
+    Mapped_Tensor& operator=(Mapped_Tensor&& other);
+
+    // false (with a message on stderr) if the file is missing, truncated or not a tensor file
+    bool open(const std::string& path);
+
+    void close();
+
+    bool is_open() const;
+
+    const void* data() const;
+
+    template <typename T>
+    const T* data_as() const
+    {
+        return static_cast<const T*>(data());
+    }
+
+    Tensor_Dtype dtype() const;
+
+    Tensor_Layout layout() const;
+
+    // the stored dimensions, outermost first
+    std::vector<uint32_t> shape() const;
+
+    size_t num_elements() const;
+
+    size_t size_bytes() const;
+
+    ~Mapped_Tensor();
+private:
+    Tensor_File_Header _header;
+    void* _mapping;
+    size_t _mapping_size;
+    std::vector<uint64_t> _buffer; // holds the data when the file cannot be mapped
+    const void* _data;
+};
+
+// single pass parser for the text dumps ("Layer 62 o (1, 28, 28, 21)" then one value per line) over a mapped file.
+// no regex and no per-line strings, values go through std::from_chars straight into vec, which is sized from
+// the header shape. with a thread pool, files above parallel_min_bytes are cut at line breaks into chunks parsed
+// in parallel. a malformed value, a value outside int8 or an element count that does not match the shape
+// rejects the file (false, message on stderr, vec and shape left empty)
+bool parse_text_dump(
+    const std::string& path,
+    std::vector<int8_t>& vec,
+    std::vector<uint32_t>& shape,
+    obj_detect::Thread_Pool* thread_pool = nullptr,
+    const size_t parallel_min_bytes = 64 * 1024);
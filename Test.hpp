@@ -3,14 +3,38 @@
 #include <iostream>
 #include <array>
 #include <vector>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <regex>
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <iterator>
 
 #include "Thread_Pool.hpp"
 #include "Utils.hpp"
 #include "Tools.hpp"
 #include "Timer.hpp"
+#include "Fast_Timer.hpp"
+#include "Perf_Counters.hpp"
+#include "Probe.hpp"
+#include "Argmax_Simd.hpp"
+#include "Frame_Pipeline.hpp"
+#include "Connected_Components.hpp"
 
 #define NUM_THREADS 4
 
+#ifndef FCN224_DATA_DIR
+#define FCN224_DATA_DIR "fcn224_data"
+#endif
+
+// global heap allocations so far, counted by the operator new of Alloc_Counter.cpp
+extern std::atomic<unsigned long> g_num_allocations;
+
 static unsigned int cycles = 1000;
 
 void argmax_example()
@@ -41,6 +65,7 @@ void argmax_benchmark(
     std::vector<int8_t> tensor(size);
     std::vector<int8_t> mat(mat_size);
 
+    const Timer_Key timer_key = Timer::Get().key("Argmax -" + std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters));
     srand(seed);
     for(unsigned int c=0; c<cycles; c++)
     {
@@ -49,7 +74,7 @@ void argmax_benchmark(
             i = rand()%256 - 128;
         }
 
-        Timer::Get().start("Argmax -" + std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters));
+        Timer::Get().start(timer_key);
         argmax_tensor(tensor.data(), mat.data(), num_filters, mat_size);
         Timer::Get().stop();
     }
@@ -69,6 +94,7 @@ void argmax_win_benchmark(
     std::vector<int8_t> tensor(size);
     std::vector<int8_t> mat(new_size);
 
+    const Timer_Key timer_key = Timer::Get().key("Argmax win-" + std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters));
     srand(seed);
     for(unsigned int c=0; c<cycles; c++)
     {
@@ -77,7 +103,7 @@ void argmax_win_benchmark(
             i = rand()%256 - 128;
         }
 
-        Timer::Get().start("Argmax win-" + std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters));
+        Timer::Get().start(timer_key);
         const int8_t* ptr = tensor.data();
         for(auto& i : mat)
         {
@@ -91,6 +117,85 @@ void argmax_win_benchmark(
     // print_tensor(mat.data(), num_rows, num_columns, 1);
 }
 
+void argmax_simd_benchmark(
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int cycles,
+    unsigned const int seed,
+    const Simd_Isa isa
+)
+{
+    const unsigned int size = num_rows * num_columns * num_filters;
+    const unsigned int mat_size = num_rows * num_columns;
+
+    std::vector<int8_t> tensor(size);
+    std::vector<int8_t> mat(mat_size);
+
+    const Timer_Key timer_key = Timer::Get().key("Argmax " + std::string(simd_isa_name(isa)) + "-" + std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters));
+    srand(seed);
+    for(unsigned int c=0; c<cycles; c++)
+    {
+        for(auto& i : tensor)
+        {
+            i = rand()%256 - 128;
+        }
+
+        Timer::Get().start(timer_key);
+        argmax_tensor_simd(tensor.data(), mat.data(), num_filters, mat_size, isa);
+        Timer::Get().stop();
+    }
+}
+
+void argmax_planar_benchmark(
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int cycles,
+    unsigned const int seed
+)
+{
+    const unsigned int size = num_rows * num_columns * num_filters;
+    const unsigned int mat_size = num_rows * num_columns;
+    const std::string shape = std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters);
+
+    const Timer_Key transpose_argmax_key = Timer::Get().key("Transpose+argmax-" + shape);
+    const Timer_Key transpose_simd_key = Timer::Get().key("Transpose+SIMD-" + shape);
+    const Timer_Key planar_key = Timer::Get().key("Argmax planar-" + shape);
+    const Timer_Key planar_simd_key = Timer::Get().key("Argmax planar SIMD-" + shape);
+
+    std::vector<int8_t> planar_tensor(size);
+    std::vector<int8_t> tensor(size);
+    std::vector<int8_t> mat(mat_size);
+
+    srand(seed);
+    for(unsigned int c=0; c<cycles; c++)
+    {
+        for(auto& i : planar_tensor)
+        {
+            i = rand()%256 - 128;
+        }
+
+        Timer::Get().start(transpose_argmax_key);
+        planar_to_channel_last(planar_tensor.data(), tensor.data(), num_filters, mat_size);
+        argmax_tensor(tensor.data(), mat.data(), num_filters, mat_size);
+        Timer::Get().stop();
+
+        Timer::Get().start(transpose_simd_key);
+        planar_to_channel_last(planar_tensor.data(), tensor.data(), num_filters, mat_size);
+        argmax_tensor_simd(tensor.data(), mat.data(), num_filters, mat_size);
+        Timer::Get().stop();
+
+        Timer::Get().start(planar_key);
+        argmax_planar(planar_tensor.data(), mat.data(), num_filters, mat_size);
+        Timer::Get().stop();
+
+        Timer::Get().start(planar_simd_key);
+        argmax_tensor_simd(planar_tensor.data(), mat.data(), num_filters, mat_size, Tensor_Layout::planar);
+        Timer::Get().stop();
+    }
+}
+
 void argmax_mt_benchmark(
     const unsigned int num_rows,
     const unsigned int num_columns,
@@ -107,11 +212,8 @@ void argmax_mt_benchmark(
 
     srand(seed);
     obj_detect::Thread_Pool thread_pool(NUM_THREADS);
-    const unsigned int work_per_thread = mat_size/NUM_THREADS;
-    const unsigned int work_left = mat_size%NUM_THREADS;
-    unsigned int total_work_count = 0;
-    unsigned int work_count = 0;
-    
+    const Timer_Key timer_key = Timer::Get().key("Argmax MT-" + std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters));
+
     for(unsigned int c=0; c<cycles; c++)
     {
         for(auto& i : tensor)
@@ -119,27 +221,51 @@ void argmax_mt_benchmark(
             i = rand()%256 - 128;
         }
 
-        Timer::Get().start("Argmax MT-" + std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters));
-        total_work_count = 0;
-        for(unsigned int i=0; i<NUM_THREADS; i++)
+        Timer::Get().start(timer_key);
+        argmax_tensor_mt(tensor.data(), mat.data(), num_filters, mat_size, thread_pool);
+        Timer::Get().stop();
+    }
+}
+
+void argmax_partition_benchmark(
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int cycles,
+    unsigned const int seed
+)
+{
+    const unsigned int size = num_rows * num_columns * num_filters;
+    const unsigned int mat_size = num_rows * num_columns;
+    const std::string shape = std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters);
+    const std::pair<obj_detect::Partition, Timer_Key> partitions[] = {
+        {obj_detect::Partition::static_chunks, Timer::Get().key("Argmax MT static-" + shape)},
+        {obj_detect::Partition::dynamic, Timer::Get().key("Argmax MT dynamic-" + shape)},
+        {obj_detect::Partition::guided, Timer::Get().key("Argmax MT guided-" + shape)}};
+
+    std::vector<int8_t> tensor(size);
+    std::vector<int8_t> mat(mat_size);
+
+    srand(seed);
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+
+    for(unsigned int c=0; c<cycles; c++)
+    {
+        for(auto& i : tensor)
         {
-            work_count = (i < work_left ? work_per_thread + 1 : work_per_thread);
-            thread_pool.assign([&, total_work_count, work_count](){
-                argmax_tensor(
-                    tensor.data() + num_filters*total_work_count, 
-                    mat.data() + total_work_count, 
-                    num_filters, 
-                    work_count);
-            });
-            total_work_count += work_count;
+            i = rand()%256 - 128;
         }
 
-        thread_pool.wait_until(NUM_THREADS);
-        Timer::Get().stop();
+        // dynamic and guided hand out work a row at a time at the finest
+        for(const auto& partition : partitions)
+        {
+            Timer::Get().start(partition.second);
+            argmax_tensor_mt(tensor.data(), mat.data(), num_filters, mat_size, thread_pool, partition.first, num_columns);
+            Timer::Get().stop();
+        }
     }
 }
 
-
 void upsampler_example()
 {
     // r, c, f
@@ -207,6 +333,7 @@ void upsampler_benchmark(
 
     std::vector<int8_t> tensor(size);
     std::vector<int8_t> new_tensor(new_size);
+    const Timer_Key timer_key = Timer::Get().key("Upsampler-" + std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters) + "-" +  std::to_string(scale_up_factor));
 
     srand(seed);
     for(unsigned int c=0; c<cycles; c++)
@@ -215,12 +342,46 @@ void upsampler_benchmark(
         {
             tensor[i] = rand()%256 - 128;
         }
-        Timer::Get().start("Upsampler-" + std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters) + "-" +  std::to_string(scale_up_factor));
+        Timer::Get().start(timer_key);
         upsampler(tensor.data(), new_tensor.data(), num_rows, num_columns, num_filters, scale_up_factor);
         Timer::Get().stop();
     }
 }
 
+void upsampler_mt_benchmark(
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scaled_up_num_rows,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int cycles,
+    unsigned const int seed
+)
+{
+    const unsigned int size = num_rows * num_columns * num_filters;
+    const unsigned int new_size = scaled_up_num_rows * scaled_up_num_columns * num_filters;
+    const std::string shape = std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters) + "-" +
+        std::to_string(scaled_up_num_columns) + "x" + std::to_string(scaled_up_num_rows);
+
+    std::vector<int8_t> tensor(size);
+    std::vector<int8_t> new_tensor(new_size);
+    const Upsample_Plan plan = make_upsample_plan(num_rows, num_columns, scaled_up_num_rows, scaled_up_num_columns);
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    const Timer_Key timer_key = Timer::Get().key("Upsampler MT-" + shape);
+
+    srand(seed);
+    for(unsigned int c=0; c<cycles; c++)
+    {
+        for(unsigned int i=0; i<size; i++)
+        {
+            tensor[i] = rand()%256 - 128;
+        }
+        Timer::Get().start(timer_key);
+        upsampler_mt(tensor.data(), new_tensor.data(), plan, num_filters, thread_pool);
+        Timer::Get().stop();
+    }
+}
+
 void benchmark(unsigned const int seed)
 {
     argmax_benchmark(224, 224, 21, cycles, seed);
@@ -229,9 +390,23 @@ void benchmark(unsigned const int seed)
     argmax_benchmark(28, 28, 21, cycles, seed);
     argmax_win_benchmark(28, 28, 21, cycles, seed);
     argmax_mt_benchmark(28, 28, 21, cycles, seed);
+    for(const Simd_Isa isa : {Simd_Isa::sse41, Simd_Isa::avx2, Simd_Isa::avx512bw})
+    {
+        if(!simd_isa_supported(isa)) continue;
+        argmax_simd_benchmark(224, 224, 21, cycles, seed, isa);
+        argmax_simd_benchmark(28, 28, 21, cycles, seed, isa);
+    }
+    argmax_partition_benchmark(224, 224, 21, cycles, seed);
+    argmax_partition_benchmark(28, 28, 21, cycles, seed);
+    argmax_planar_benchmark(224, 224, 21, cycles, seed);
+    argmax_planar_benchmark(28, 28, 21, cycles, seed);
 
     upsampler_benchmark(28, 28, 21, 8, cycles, seed);
     upsampler_benchmark(28, 28, 1, 8, cycles, seed);
+    upsampler_mt_benchmark(28, 28, 21, 224, 224, cycles, seed);
+    upsampler_mt_benchmark(28, 28, 1, 224, 224, cycles, seed);
+    upsampler_mt_benchmark(28, 28, 1, 480, 640, cycles, seed);
+    upsampler_mt_benchmark(28, 28, 21, 480, 640, cycles, seed);
 }
 
 std::vector<int8_t> sim_up_scale_argmax(
@@ -255,10 +430,7 @@ std::vector<int8_t> sim_up_scale_argmax(
     srand(seed);
 
     obj_detect::Thread_Pool thread_pool(NUM_THREADS);
-    const unsigned int work_per_thread = scaled_up_mat_size/NUM_THREADS;
-    const unsigned int work_left = scaled_up_mat_size%NUM_THREADS;
-    unsigned int total_work_count = 0;
-    unsigned int work_count = 0;
+    const Timer_Key timer_key = Timer::Get().key("up scale->argmax");
 
     for(unsigned int c=0; c<cycles;c++)
     {
@@ -267,23 +439,9 @@ std::vector<int8_t> sim_up_scale_argmax(
             item = rand()%256 - 128;
         }
         
-        Timer::Get().start("up scale->argmax");
+        Timer::Get().start(timer_key);
         upsampler(tensor.data(), scaled_up_tensor.data(), num_rows, num_columns, num_filters, scale_up_factor);
-        total_work_count = 0;
-        for(unsigned int i=0; i<NUM_THREADS; i++)
-        {
-            work_count = (i < work_left ? work_per_thread + 1 : work_per_thread);
-            thread_pool.assign([total_work_count, work_count, &num_filters, &scaled_up_tensor, &scaled_up_mat](){
-                argmax_tensor(
-                    scaled_up_tensor.data() + num_filters*total_work_count, 
-                    scaled_up_mat.data() + total_work_count, 
-                    num_filters, 
-                    work_count);
-            });
-            total_work_count += work_count;
-        }
-
-        thread_pool.wait_until(NUM_THREADS);
+        argmax_tensor_mt(scaled_up_tensor.data(), scaled_up_mat.data(), num_filters, scaled_up_mat_size, thread_pool);
         Timer::Get().stop();
     }
 
@@ -311,10 +469,7 @@ std::vector<int8_t> sim_argmax_up_scale(
     srand(seed);
 
     obj_detect::Thread_Pool thread_pool(NUM_THREADS);
-    const unsigned int work_per_thread = mat_size/NUM_THREADS;
-    const unsigned int work_left = mat_size%NUM_THREADS;
-    unsigned int total_work_count = 0;
-    unsigned int work_count = 0;
+    const Timer_Key timer_key = Timer::Get().key("argmax->up scale");
     
     for(unsigned int c=0; c<cycles;c++)
     {
@@ -323,24 +478,124 @@ std::vector<int8_t> sim_argmax_up_scale(
             item = rand()%256 - 128;
         }
     
-        Timer::Get().start("argmax->up scale");
-        total_work_count = 0;
-        for(unsigned int i=0; i<NUM_THREADS; i++)
-        {
-            work_count = (i < work_left ? work_per_thread + 1 : work_per_thread);
-            thread_pool.assign([total_work_count, work_count, &num_filters, &tensor, &mat](){
-                argmax_tensor(
-                    tensor.data() + num_filters*total_work_count, 
-                    mat.data() + total_work_count, 
-                    num_filters, 
-                    work_count);
-            });
-            total_work_count += work_count;
+        Timer::Get().start(timer_key);
+        argmax_tensor_mt(tensor.data(), mat.data(), num_filters, mat_size, thread_pool);
+
+        upsampler(mat.data(), scaled_up_mat.data(), num_rows, num_columns, 1, scale_up_factor);
+        Timer::Get().stop();
+    }
+
+    return scaled_up_mat;
+}
+
+std::vector<int8_t> sim_argmax_up_scale_fused(
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor,
+    const unsigned int cycles,
+    unsigned const int seed)
+{
+    const unsigned int tensor_size = num_rows * num_columns * num_filters;
+    const unsigned int scaled_up_num_rows = num_rows * scale_up_factor;
+    const unsigned int scaled_up_num_columns = num_columns * scale_up_factor;
+    const unsigned int scaled_up_mat_size = scaled_up_num_rows * scaled_up_num_columns;
+
+    std::vector<int8_t> tensor(tensor_size);
+    std::vector<int8_t> scaled_up_mat(scaled_up_mat_size);
+
+    srand(seed);
+
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    const Timer_Key timer_key = Timer::Get().key("argmax->up scale fused");
+
+    for(unsigned int c=0; c<cycles;c++)
+    {
+        for(auto& item : tensor)
+        {
+            item = rand()%256 - 128;
         }
 
-        thread_pool.wait_until(NUM_THREADS);
+        Timer::Get().start(timer_key);
+        argmax_up_scale_mt(tensor.data(), scaled_up_mat.data(), num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+        Timer::Get().stop();
+    }
+
+    return scaled_up_mat;
+}
 
-        upsampler(mat.data(), scaled_up_mat.data(), num_rows, num_columns, 1, scale_up_factor);
+// the class map of the fused kernel with the confidence planes written alongside, what the downstream filter runs
+std::vector<int8_t> sim_argmax_top2_up_scale_fused(
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor,
+    const unsigned int cycles,
+    unsigned const int seed)
+{
+    const unsigned int tensor_size = num_rows * num_columns * num_filters;
+    const unsigned int scaled_up_num_rows = num_rows * scale_up_factor;
+    const unsigned int scaled_up_num_columns = num_columns * scale_up_factor;
+    const unsigned int scaled_up_mat_size = scaled_up_num_rows * scaled_up_num_columns;
+
+    std::vector<int8_t> tensor(tensor_size);
+    std::vector<int8_t> scaled_up_mat(scaled_up_mat_size);
+    std::vector<int8_t> scaled_up_value(scaled_up_mat_size);
+    std::vector<uint8_t> scaled_up_margin(scaled_up_mat_size);
+
+    srand(seed);
+
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    const Timer_Key timer_key = Timer::Get().key("argmax top2->up scale fused");
+
+    for(unsigned int c=0; c<cycles;c++)
+    {
+        for(auto& item : tensor)
+        {
+            item = rand()%256 - 128;
+        }
+
+        Timer::Get().start(timer_key);
+        argmax_top2_up_scale_mt(
+            tensor.data(), scaled_up_mat.data(), scaled_up_value.data(), scaled_up_margin.data(),
+            num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+        Timer::Get().stop();
+    }
+
+    return scaled_up_mat;
+}
+
+std::vector<int8_t> sim_bilinear_argmax(
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor,
+    const unsigned int cycles,
+    unsigned const int seed)
+{
+    const unsigned int tensor_size = num_rows * num_columns * num_filters;
+    const unsigned int scaled_up_num_rows = num_rows * scale_up_factor;
+    const unsigned int scaled_up_num_columns = num_columns * scale_up_factor;
+    const unsigned int scaled_up_mat_size = scaled_up_num_rows * scaled_up_num_columns;
+
+    std::vector<int8_t> tensor(tensor_size);
+    std::vector<int8_t> scaled_up_mat(scaled_up_mat_size);
+    const Bilinear_Plan plan = make_bilinear_plan(num_rows, num_columns, scaled_up_num_rows, scaled_up_num_columns);
+
+    srand(seed);
+
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    const Timer_Key timer_key = Timer::Get().key("bilinear->argmax fused");
+
+    for(unsigned int c=0; c<cycles;c++)
+    {
+        for(auto& item : tensor)
+        {
+            item = rand()%256 - 128;
+        }
+
+        Timer::Get().start(timer_key);
+        bilinear_argmax_mt(tensor.data(), scaled_up_mat.data(), plan, num_filters, thread_pool);
         Timer::Get().stop();
     }
 
@@ -355,7 +610,14 @@ void test()
     unsigned const int seed = time(NULL);
     std::vector<int8_t> sim_1_out = sim_up_scale_argmax(28, 28, 21, 8, cycles, seed);
     std::vector<int8_t> sim_2_out = sim_argmax_up_scale(28, 28, 21, 8, cycles, seed);
+    std::vector<int8_t> sim_3_out = sim_argmax_up_scale_fused(28, 28, 21, 8, cycles, seed);
     comp_vec(sim_1_out, sim_2_out);
+    comp_vec(sim_1_out, sim_3_out);
+    comp_vec(sim_2_out, sim_3_out);
+    std::vector<int8_t> sim_4_out = sim_argmax_top2_up_scale_fused(28, 28, 21, 8, cycles, seed);
+    comp_vec(sim_1_out, sim_4_out);
+    // bilinear masks differ from the nearest-neighbour ones by design, only the cost is compared
+    sim_bilinear_argmax(28, 28, 21, 8, cycles, seed);
 
     benchmark(seed);
 
@@ -374,8 +636,8 @@ void sim_model_outputs()
     unsigned int output_height = 0;
     unsigned int output_channel = 0;
 
-    vector_populator("..\\..\\fcn224_data\\o_62.txt", input_tensor, input_width, input_height, input_channel);
-    vector_populator("..\\..\\fcn224_data\\o_64.txt", output_tensor, output_width, output_height, output_channel);
+    vector_populator(std::string(FCN224_DATA_DIR) + "/o_62.txt", input_tensor, input_width, input_height, input_channel);
+    vector_populator(std::string(FCN224_DATA_DIR) + "/o_64.txt", output_tensor, output_width, output_height, output_channel);
 
     std::vector<int8_t> mat(input_width*input_height);
     const int8_t* ptr = input_tensor.data();
@@ -385,8 +647,8 @@ void sim_model_outputs()
         ptr += input_channel;
     }
 
-    std::vector<int8_t> output_tensor_algo(224*224);
-    upsampler(mat.data(), output_tensor_algo.data(), input_width, input_height, 1, 8);
+    std::vector<int8_t> output_tensor_algo(output_width*output_height);
+    upsampler(mat.data(), output_tensor_algo.data(), input_height, input_width, 1, output_width / input_width);
 
     comp_vec(output_tensor, output_tensor_algo);
 }
@@ -422,4 +684,1939 @@ void test_argmax_mt()
         std::cout<<"R : "<< num_rows<<" | ";
         std::cout<<"F : "<< num_filters<<std::endl;
     }
-}
\ No newline at end of file
+}
+
+void test_argmax_simd()
+{
+    std::cout<<"Best ISA : "<< simd_isa_name(simd_isa_best()) <<std::endl;
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_columns = rand()%200 + 1;
+        const unsigned int num_rows = rand()%200 + 1;
+        const unsigned int num_filters = rand()%200 + 1;
+        // a narrow range at INT8_MIN forces ties, which must resolve to the first index
+        const unsigned int value_range = (i%2 == 0) ? 256 : 3;
+
+        const unsigned int tensor_size = num_columns*num_rows*num_filters;
+        const unsigned int mat_size = num_columns*num_rows;
+
+        std::vector<int8_t> tensor(tensor_size);
+        std::vector<int8_t> mat_1(mat_size);
+        std::vector<int8_t> mat_2(mat_size);
+
+        for(auto& item : tensor)
+        {
+            item = rand()%value_range - 128;
+        }
+
+        argmax_tensor(tensor.data(), mat_1.data(), num_filters, mat_size);
+        for(const Simd_Isa isa : {Simd_Isa::sse41, Simd_Isa::avx2, Simd_Isa::avx512bw})
+        {
+            if(!simd_isa_supported(isa)) continue;
+            std::fill(mat_2.begin(), mat_2.end(), -1);
+            argmax_tensor_simd(tensor.data(), mat_2.data(), num_filters, mat_size, isa);
+            comp_vec(mat_1, mat_2);
+        }
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"C : "<< num_columns<<" | ";
+        std::cout<<"R : "<< num_rows<<" | ";
+        std::cout<<"F : "<< num_filters<<std::endl;
+    }
+}
+
+// top-2 kernels against a two pass reference : argmax_tensor, then the max and the best of the other classes
+void test_argmax_top2()
+{
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_theads = rand()%15 + 1;
+        const unsigned int num_columns = rand()%200 + 1;
+        const unsigned int num_rows = rand()%50 + 1;
+        // mostly class counts that fit in one vector, the kernels fall back to scalar past that
+        const unsigned int num_filters = (i%3 == 2) ? rand()%200 + 1 : rand()%64 + 1;
+        // a narrow range at INT8_MIN forces ties, which have a margin of 0
+        const unsigned int value_range = (i%2 == 0) ? 256 : 3;
+        const unsigned int scale_up_factor = rand()%4 + 1;
+
+        const unsigned int mat_size = num_columns*num_rows;
+        const unsigned int scaled_up_mat_size = mat_size*scale_up_factor*scale_up_factor;
+
+        obj_detect::Thread_Pool thread_pool(num_theads);
+        std::vector<int8_t> tensor((size_t)mat_size*num_filters);
+        for(auto& item : tensor)
+        {
+            item = rand()%value_range - 128;
+        }
+
+        std::vector<int8_t> mat_1(mat_size);
+        std::vector<int8_t> value_1(mat_size);
+        std::vector<uint8_t> margin_1(mat_size);
+        argmax_tensor(tensor.data(), mat_1.data(), num_filters, mat_size);
+        for(unsigned int c=0; c<mat_size; c++)
+        {
+            const int8_t* const cell_cptr = tensor.data() + (size_t)c*num_filters;
+            // class indices past 127 wrap in the int8 map
+            const unsigned int index = (uint8_t)mat_1[c];
+            int runner_up = num_filters > 1 ? INT8_MIN : cell_cptr[0];
+            for(unsigned int f=0; f<num_filters; f++)
+            {
+                if(f != index && cell_cptr[f] > runner_up) runner_up = cell_cptr[f];
+            }
+            value_1[c] = cell_cptr[index];
+            margin_1[c] = (uint8_t)(value_1[c] - runner_up);
+        }
+
+        std::vector<int8_t> mat_2(mat_size);
+        std::vector<int8_t> value_2(mat_size);
+        std::vector<uint8_t> margin_2(mat_size);
+        auto check = [&]()
+        {
+            comp_vec(mat_1, mat_2);
+            comp_vec(value_1, value_2);
+            comp_vec(margin_1, margin_2);
+            std::fill(mat_2.begin(), mat_2.end(), -1);
+            std::fill(value_2.begin(), value_2.end(), -1);
+            std::fill(margin_2.begin(), margin_2.end(), 255);
+        };
+
+        argmax_top2_tensor(tensor.data(), mat_2.data(), value_2.data(), margin_2.data(), num_filters, mat_size);
+        check();
+        for(const Simd_Isa isa : {Simd_Isa::sse41, Simd_Isa::avx2, Simd_Isa::avx512bw})
+        {
+            if(!simd_isa_supported(isa)) continue;
+            argmax_top2_simd(tensor.data(), mat_2.data(), value_2.data(), margin_2.data(), num_filters, mat_size, isa);
+            check();
+        }
+        argmax_top2_tensor_mt(tensor.data(), mat_2.data(), value_2.data(), margin_2.data(), num_filters, mat_size, thread_pool,
+            obj_detect::Partition::dynamic, num_columns);
+        check();
+
+        // planes left out are not touched
+        argmax_top2_simd(tensor.data(), mat_2.data(), nullptr, nullptr, num_filters, mat_size);
+        comp_vec(mat_1, mat_2);
+        if(std::count(value_2.begin(), value_2.end(), -1) != (long)mat_size) std::cout<<"Top-2 wrote a null plane"<<std::endl;
+
+        // the fused path upsamples every plane exactly like upsampler does the class map
+        std::vector<int8_t> scaled_up_mat_1(scaled_up_mat_size);
+        std::vector<int8_t> scaled_up_value_1(scaled_up_mat_size);
+        std::vector<uint8_t> scaled_up_margin_1(scaled_up_mat_size);
+        upsampler(mat_1.data(), scaled_up_mat_1.data(), num_rows, num_columns, 1, scale_up_factor);
+        upsampler(value_1.data(), scaled_up_value_1.data(), num_rows, num_columns, 1, scale_up_factor);
+        upsampler(margin_1.data(), scaled_up_margin_1.data(), num_rows, num_columns, 1, scale_up_factor);
+        std::vector<int8_t> scaled_up_mat_2(scaled_up_mat_size);
+        std::vector<int8_t> scaled_up_value_2(scaled_up_mat_size);
+        std::vector<uint8_t> scaled_up_margin_2(scaled_up_mat_size);
+        argmax_top2_up_scale_mt(
+            tensor.data(), scaled_up_mat_2.data(), scaled_up_value_2.data(), scaled_up_margin_2.data(),
+            num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+        comp_vec(scaled_up_mat_1, scaled_up_mat_2);
+        comp_vec(scaled_up_value_1, scaled_up_value_2);
+        comp_vec(scaled_up_margin_1, scaled_up_margin_2);
+        std::fill(scaled_up_mat_2.begin(), scaled_up_mat_2.end(), -1);
+        argmax_top2_up_scale_mt(
+            tensor.data(), scaled_up_mat_2.data(), (int8_t*)nullptr, scaled_up_margin_2.data(),
+            num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+        comp_vec(scaled_up_mat_1, scaled_up_mat_2);
+
+        // wider index types keep the classes past 127, uint8 indices still take the SIMD kernels
+        std::vector<uint16_t> index_1(mat_size);
+        for(unsigned int c=0; c<mat_size; c++) index_1[c] = (uint16_t)argmax(tensor.data() + (size_t)c*num_filters, num_filters);
+        std::vector<uint16_t> index_2(mat_size, UINT16_MAX);
+        argmax_top2_tensor_mt(tensor.data(), index_2.data(), value_2.data(), margin_2.data(), num_filters, mat_size, thread_pool);
+        comp_vec(index_1, index_2);
+        comp_vec(value_1, value_2);
+        comp_vec(margin_1, margin_2);
+        const std::vector<uint8_t> index_3(index_1.begin(), index_1.end());
+        std::vector<uint8_t> index_4(mat_size, 255);
+        argmax_top2_tensor_mt(tensor.data(), index_4.data(), value_2.data(), margin_2.data(), num_filters, mat_size, thread_pool);
+        comp_vec(index_3, index_4);
+        comp_vec(value_1, value_2);
+        comp_vec(margin_1, margin_2);
+        std::vector<uint16_t> scaled_up_index_1(scaled_up_mat_size);
+        upsampler(index_1.data(), scaled_up_index_1.data(), num_rows, num_columns, 1, scale_up_factor);
+        std::vector<uint16_t> scaled_up_index_2(scaled_up_mat_size, UINT16_MAX);
+        argmax_top2_up_scale_mt(
+            tensor.data(), scaled_up_index_2.data(), scaled_up_value_2.data(), scaled_up_margin_2.data(),
+            num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+        comp_vec(scaled_up_index_1, scaled_up_index_2);
+        comp_vec(scaled_up_value_1, scaled_up_value_2);
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"T : "<< num_theads<<" | ";
+        std::cout<<"C : "<< num_columns<<" | ";
+        std::cout<<"R : "<< num_rows<<" | ";
+        std::cout<<"F : "<< num_filters<<" | ";
+        std::cout<<"S : "<< scale_up_factor<<std::endl;
+    }
+}
+
+// quantization-aware argmax against dequantizing to double first. classes whose real logits are within the fixed-point
+// precision of the max may go either way, any other cell must match
+void test_argmax_quantized()
+{
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_theads = rand()%15 + 1;
+        const unsigned int num_columns = rand()%200 + 1;
+        const unsigned int num_rows = rand()%50 + 1;
+        // every third run takes more classes than an int8 index holds
+        const unsigned int num_filters = (i%3 == 2) ? rand()%128 + 129 : rand()%100 + 1;
+        const unsigned int value_range = (i%2 == 0) ? 256 : 3;
+
+        const unsigned int mat_size = num_columns*num_rows;
+        obj_detect::Thread_Pool thread_pool(num_theads);
+        std::vector<int8_t> tensor((size_t)mat_size*num_filters);
+        for(auto& item : tensor)
+        {
+            item = rand()%value_range - 128;
+        }
+
+        Quant_Params params;
+        for(unsigned int f=0; f<num_filters; f++)
+        {
+            params.scale.push_back(0.001f * (rand()%200 + 1));
+            params.zero_point.push_back(rand()%41 - 20);
+        }
+        Quant_Plan plan;
+        if(!make_quant_plan(params, num_filters, plan)) std::cerr<<"Quantization plan rejected per-channel params"<<std::endl;
+
+        auto real_logit = [&](const unsigned int c, const unsigned int f)
+        {
+            return (double)params.scale[f] * (tensor[(size_t)c*num_filters + f] - params.zero_point[f]);
+        };
+        std::vector<double> max_vals(mat_size);
+        for(unsigned int c=0; c<mat_size; c++)
+        {
+            max_vals[c] = real_logit(c, 0);
+            for(unsigned int f=1; f<num_filters; f++) max_vals[c] = std::max(max_vals[c], real_logit(c, f));
+        }
+        auto check = [&](std::vector<int8_t>& mat)
+        {
+            unsigned int wrong = 0;
+            for(unsigned int c=0; c<mat_size; c++)
+            {
+                const unsigned int f = (uint8_t)mat[c];
+                wrong += f >= num_filters || real_logit(c, f) < max_vals[c] - 1e-6 * std::max(1.0, std::fabs(max_vals[c]));
+            }
+            if(wrong > 0) std::cerr<<"Quantized argmax picked a lower class in "<< wrong <<" cells"<<std::endl;
+            std::fill(mat.begin(), mat.end(), -1);
+        };
+
+        std::vector<int8_t> mat_1(mat_size, -1);
+        std::vector<int8_t> mat_2(mat_size, -1);
+        argmax_quantized_tensor(tensor.data(), mat_1.data(), plan, mat_size);
+        for(const Simd_Isa isa : {Simd_Isa::sse41, Simd_Isa::avx2, Simd_Isa::avx512bw})
+        {
+            if(!simd_isa_supported(isa)) continue;
+            argmax_quantized_simd(tensor.data(), mat_2.data(), plan.multiplier.data(), plan.offset.data(), num_filters, mat_size, isa);
+            // every kernel compares the same keys, so they agree on ties too
+            comp_vec(mat_1, mat_2);
+            check(mat_2);
+        }
+        argmax_quantized_tensor_mt(tensor.data(), mat_2.data(), plan, mat_size, thread_pool, obj_detect::Partition::dynamic, num_columns);
+        comp_vec(mat_1, mat_2);
+
+        // wider index types keep the classes past 127, uint8 indices still take the SIMD kernels
+        const std::vector<uint8_t> index_1(mat_1.begin(), mat_1.end());
+        const std::vector<uint16_t> index_2(index_1.begin(), index_1.end());
+        std::vector<uint16_t> index_3(mat_size, UINT16_MAX);
+        argmax_quantized_tensor_mt(tensor.data(), index_3.data(), plan, mat_size, thread_pool, obj_detect::Partition::dynamic, num_columns);
+        comp_vec(index_2, index_3);
+        std::vector<uint8_t> index_4(mat_size, 255);
+        argmax_quantized_tensor_mt(tensor.data(), index_4.data(), plan, mat_size, thread_pool, obj_detect::Partition::dynamic, num_columns);
+        comp_vec(index_1, index_4);
+        for(const Simd_Isa isa : {Simd_Isa::sse41, Simd_Isa::avx2, Simd_Isa::avx512bw})
+        {
+            if(!simd_isa_supported(isa)) continue;
+            std::fill(index_4.begin(), index_4.end(), 255);
+            argmax_quantized_simd(tensor.data(), index_4.data(), plan.multiplier.data(), plan.offset.data(), num_filters, mat_size, isa);
+            comp_vec(index_1, index_4);
+        }
+        check(mat_1);
+
+        // the raw comparison is what per-channel models got before
+        std::vector<int8_t> mat_raw(mat_size);
+        argmax_tensor(tensor.data(), mat_raw.data(), num_filters, mat_size);
+        unsigned int raw_wrong = 0;
+        for(unsigned int c=0; c<mat_size; c++) raw_wrong += real_logit(c, (uint8_t)mat_raw[c]) < max_vals[c];
+
+        // per-tensor params take the raw fast path and match argmax_tensor
+        Quant_Plan uniform_plan;
+        make_quant_plan(Quant_Params{{0.05f}, {3}}, num_filters, uniform_plan);
+        if(!uniform_plan.uniform || (plan.uniform && num_filters > 1)) std::cout<<"Quantization plan uniformity is wrong"<<std::endl;
+        std::fill(mat_2.begin(), mat_2.end(), -1);
+        argmax_quantized_tensor_mt(tensor.data(), mat_2.data(), uniform_plan, mat_size, thread_pool);
+        comp_vec(mat_raw, mat_2);
+
+        // a table that is neither per-tensor nor per-class is refused instead of read past its end
+        Quant_Plan bad_plan;
+        const Quant_Params short_params{std::vector<float>(num_filters + 1, 0.05f), {3}};
+        if(make_quant_plan(short_params, num_filters, bad_plan) || bad_plan.num_filters != 0) std::cerr<<"Quantization plan accepted mismatched params"<<std::endl;
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"T : "<< num_theads<<" | ";
+        std::cout<<"C : "<< num_columns<<" | ";
+        std::cout<<"R : "<< num_rows<<" | ";
+        std::cout<<"F : "<< num_filters<<" | ";
+        std::cout<<"Raw argmax wrong : "<< 100.0 * raw_wrong / mat_size <<" %"<<std::endl;
+    }
+}
+
+// wide class indices and packed masks against the byte mask kernels
+void test_packed_mask()
+{
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_theads = rand()%15 + 1;
+        const unsigned int num_columns = rand()%100 + 1;
+        const unsigned int num_rows = rand()%50 + 1;
+        // up to 32 classes packs into 5 bits, some runs take more classes than an int8 index holds
+        const unsigned int num_filters = (i%3 == 2) ? rand()%300 + 129 : rand()%32 + 1;
+        const unsigned int scale_up_factor = rand()%9 + 1;
+        const unsigned int bits = num_filters <= 256 ? mask_bits_for_classes(num_filters) : 8;
+
+        const unsigned int mat_size = num_columns*num_rows;
+        const unsigned int scaled_up_mat_size = mat_size*scale_up_factor*scale_up_factor;
+        obj_detect::Thread_Pool thread_pool(num_theads);
+        std::vector<int8_t> tensor((size_t)mat_size*num_filters);
+        fill_vec(tensor);
+
+        // reference indices straight from argmax(), nothing narrower than unsigned int in between
+        std::vector<uint16_t> mat_1(mat_size);
+        for(unsigned int c=0; c<mat_size; c++) mat_1[c] = (uint16_t)argmax(tensor.data() + (size_t)c*num_filters, num_filters);
+        std::vector<uint16_t> scaled_up_mat_1(scaled_up_mat_size);
+        upsampler(mat_1.data(), scaled_up_mat_1.data(), num_rows, num_columns, 1, scale_up_factor);
+
+        std::vector<uint16_t> mat_2(mat_size);
+        argmax_tensor_mt(tensor.data(), mat_2.data(), num_filters, mat_size, thread_pool);
+        comp_vec(mat_1, mat_2);
+        std::vector<uint16_t> scaled_up_mat_2(scaled_up_mat_size);
+        argmax_up_scale_mt(tensor.data(), scaled_up_mat_2.data(), num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+        comp_vec(scaled_up_mat_1, scaled_up_mat_2);
+        if(num_filters > 256) continue;
+
+        // uint8 indices take the SIMD kernels
+        const std::vector<uint8_t> mat_3(mat_1.begin(), mat_1.end());
+        std::vector<uint8_t> mat_4(mat_size);
+        argmax_tensor_batch_mt(tensor.data(), mat_4.data(), 1, num_filters, mat_size, thread_pool);
+        comp_vec(mat_3, mat_4);
+
+        std::vector<uint8_t> packed(packed_mask_size(mat_size, bits));
+        argmax_tensor_packed_mt(tensor.data(), packed.data(), num_filters, mat_size, bits, thread_pool, obj_detect::Partition::dynamic, num_columns);
+        comp_packed_mask(packed, bits, mat_3);
+        std::fill(mat_4.begin(), mat_4.end(), 255);
+        unpack_mask(packed.data(), mat_4.data(), 0, mat_size, bits);
+        comp_vec(mat_3, mat_4);
+
+        std::vector<uint8_t> scaled_up_packed(packed_mask_size(scaled_up_mat_size, bits));
+        argmax_up_scale_packed_mt(tensor.data(), scaled_up_packed.data(), num_rows, num_columns, num_filters, scale_up_factor, bits, thread_pool);
+        comp_packed_mask(scaled_up_packed, bits, scaled_up_mat_1);
+        std::fill(scaled_up_packed.begin(), scaled_up_packed.end(), 0);
+        upsampler_packed_mt(packed.data(), scaled_up_packed.data(), num_rows, num_columns, scale_up_factor, bits, thread_pool);
+        comp_packed_mask(scaled_up_packed, bits, scaled_up_mat_1);
+
+        // a range that starts and ends mid-byte leaves its neighbours alone
+        const unsigned int first_pixel = rand()%mat_size;
+        const unsigned int count = rand()%(mat_size - first_pixel) + 1;
+        std::vector<uint8_t> mat_5(mat_3);
+        for(unsigned int c=first_pixel; c<first_pixel + count; c++) mat_5[c] = (uint8_t)(rand() % (1u << bits));
+        pack_mask(mat_5.data() + first_pixel, packed.data(), first_pixel, count, bits);
+        comp_packed_mask(packed, bits, mat_5);
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"T : "<< num_theads<<" | ";
+        std::cout<<"C : "<< num_columns<<" | ";
+        std::cout<<"R : "<< num_rows<<" | ";
+        std::cout<<"F : "<< num_filters<<" | ";
+        std::cout<<"S : "<< scale_up_factor<<" | ";
+        std::cout<<"Bits : "<< bits<<" | ";
+        std::cout<<"Bytes : "<< scaled_up_packed.size()<<" / "<< scaled_up_mat_size<<std::endl;
+    }
+}
+
+// flood fill of every blob in raster order of its first pixel, the numbering Connected_Components promises
+void connected_components_reference(const std::vector<uint8_t>& mask, const unsigned int num_rows, const unsigned int num_columns,
+    const bool eight, const unsigned int background, std::vector<uint32_t>& labels, std::vector<obj_detect::Region>& regions)
+{
+    labels.assign(mask.size(), obj_detect::Connected_Components::no_label);
+    regions.clear();
+    std::vector<uint32_t> stack;
+    for(uint32_t first=0; first<mask.size(); first++)
+    {
+        if(mask[first] == background || labels[first] != obj_detect::Connected_Components::no_label) continue;
+        const uint32_t id = (uint32_t)regions.size();
+        obj_detect::Region region{mask[first], 0, num_rows, num_columns, 0, 0, 0.0, 0.0};
+        double row_sum = 0.0;
+        double column_sum = 0.0;
+        labels[first] = id;
+        stack.assign(1, first);
+        while(!stack.empty())
+        {
+            const uint32_t pixel = stack.back();
+            stack.pop_back();
+            const int r = pixel / num_columns;
+            const int c = pixel % num_columns;
+            region.area++;
+            row_sum += r;
+            column_sum += c;
+            region.min_row = std::min(region.min_row, (unsigned int)r);
+            region.min_column = std::min(region.min_column, (unsigned int)c);
+            region.max_row = std::max(region.max_row, (unsigned int)r);
+            region.max_column = std::max(region.max_column, (unsigned int)c);
+            for(int dr=-1; dr<=1; dr++)
+            {
+                for(int dc=-1; dc<=1; dc++)
+                {
+                    if((dr == 0 && dc == 0) || (!eight && dr != 0 && dc != 0)) continue;
+                    if(r + dr < 0 || r + dr >= (int)num_rows || c + dc < 0 || c + dc >= (int)num_columns) continue;
+                    const uint32_t next = (r + dr)*num_columns + c + dc;
+                    if(mask[next] != mask[first] || labels[next] != obj_detect::Connected_Components::no_label) continue;
+                    labels[next] = id;
+                    stack.push_back(next);
+                }
+            }
+        }
+        region.centroid_row = row_sum/region.area;
+        region.centroid_column = column_sum/region.area;
+        regions.push_back(region);
+    }
+}
+
+void comp_regions(const std::vector<obj_detect::Region>& regions_1, const std::vector<obj_detect::Region>& regions_2)
+{
+    if(regions_1.size() != regions_2.size())
+    {
+        std::cerr<<"region count mismatch : "<< regions_1.size()<< " != " << regions_2.size() <<std::endl;
+        return;
+    }
+
+    for(size_t i=0; i<regions_1.size(); i++)
+    {
+        const obj_detect::Region& a = regions_1[i];
+        const obj_detect::Region& b = regions_2[i];
+        if(a.class_index != b.class_index || a.area != b.area || a.min_row != b.min_row || a.min_column != b.min_column ||
+            a.max_row != b.max_row || a.max_column != b.max_column ||
+            std::abs(a.centroid_row - b.centroid_row) > 1e-9 || std::abs(a.centroid_column - b.centroid_column) > 1e-9)
+        {
+            std::cerr<<"region mismatch : "<< i<< " class "<< a.class_index<< " != " << b.class_index
+                <<" area "<< a.area<< " != " << b.area <<std::endl;
+            return;
+        }
+    }
+}
+
+void test_connected_components()
+{
+    obj_detect::Connected_Components components;
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_theads = rand()%15 + 1;
+        const unsigned int num_columns = rand()%40 + 1;
+        const unsigned int num_rows = rand()%40 + 1;
+        const unsigned int num_classes = rand()%5 + 1;
+        const unsigned int scale_up_factor = rand()%8 + 1;
+        const bool eight = i%2 == 1;
+        const obj_detect::Connectivity connectivity = eight ? obj_detect::Connectivity::eight : obj_detect::Connectivity::four;
+        // every third run leaves a class out as background
+        const unsigned int background = (i%3 == 0) ? rand()%num_classes : obj_detect::Connected_Components::no_background;
+
+        const unsigned int mat_size = num_columns*num_rows;
+        const unsigned int scaled_up_num_rows = num_rows*scale_up_factor;
+        const unsigned int scaled_up_num_columns = num_columns*scale_up_factor;
+        const unsigned int scaled_up_mat_size = mat_size*scale_up_factor*scale_up_factor;
+        obj_detect::Thread_Pool thread_pool(num_theads);
+
+        // blobs from the upsample, ragged edges from the noise
+        std::vector<uint8_t> mat(mat_size);
+        for(auto& item : mat) item = rand()%num_classes;
+        std::vector<uint8_t> scaled_up_mat(scaled_up_mat_size);
+        upsampler(mat.data(), scaled_up_mat.data(), num_rows, num_columns, 1, scale_up_factor);
+        std::vector<uint8_t> noisy_mat(scaled_up_mat);
+        for(auto& item : noisy_mat)
+        {
+            if(rand()%20 == 0) item = rand()%num_classes;
+        }
+
+        std::vector<uint32_t> labels_1;
+        std::vector<obj_detect::Region> regions_1;
+        connected_components_reference(noisy_mat, scaled_up_num_rows, scaled_up_num_columns, eight, background, labels_1, regions_1);
+        components.label(noisy_mat.data(), scaled_up_num_rows, scaled_up_num_columns, thread_pool, connectivity, background, rand()%4 + 1);
+        comp_vec(labels_1, components.labels());
+        comp_regions(regions_1, components.regions());
+
+        // int8 masks label the same
+        const std::vector<int8_t> int8_mat(noisy_mat.begin(), noisy_mat.end());
+        components.label(int8_mat.data(), scaled_up_num_rows, scaled_up_num_columns, thread_pool, connectivity, background);
+        comp_regions(regions_1, components.regions());
+
+        // labeling before the upsample and scaling the regions matches labeling after it
+        connected_components_reference(scaled_up_mat, scaled_up_num_rows, scaled_up_num_columns, eight, background, labels_1, regions_1);
+        components.label(mat.data(), num_rows, num_columns, thread_pool, connectivity, background);
+        std::vector<obj_detect::Region> regions_2(components.regions());
+        obj_detect::scale_regions(regions_2, scale_up_factor);
+        comp_regions(regions_1, regions_2);
+
+        std::vector<obj_detect::Class_Stats> stats;
+        obj_detect::region_class_stats(regions_2, num_classes, stats);
+        std::vector<uint64_t> area_1(num_classes, 0);
+        std::vector<uint64_t> area_2(num_classes, 0);
+        for(const auto item : scaled_up_mat)
+        {
+            if(item != background) area_1[item]++;
+        }
+        for(unsigned int c=0; c<num_classes; c++) area_2[c] = stats[c].area;
+        comp_vec(area_1, area_2);
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"T : "<< num_theads<<" | ";
+        std::cout<<"C : "<< num_columns<<" | ";
+        std::cout<<"R : "<< num_rows<<" | ";
+        std::cout<<"K : "<< num_classes<<" | ";
+        std::cout<<"S : "<< scale_up_factor<<" | ";
+        std::cout<<"N : "<< (eight ? 8 : 4)<<" | ";
+        std::cout<<"Regions : "<< regions_2.size()<<std::endl;
+    }
+}
+
+void test_argmax_planar()
+{
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_columns = rand()%200 + 1;
+        const unsigned int num_rows = rand()%200 + 1;
+        // every third run takes more classes than an int8 index holds
+        const unsigned int num_filters = (i%3 == 2) ? rand()%128 + 129 : rand()%127 + 1;
+        const unsigned int value_range = (i%2 == 0) ? 256 : 3;
+
+        const unsigned int tensor_size = num_columns*num_rows*num_filters;
+        const unsigned int mat_size = num_columns*num_rows;
+
+        std::vector<int8_t> planar_tensor(tensor_size);
+        std::vector<int8_t> tensor(tensor_size);
+        std::vector<int8_t> mat_1(mat_size);
+        std::vector<int8_t> mat_2(mat_size);
+
+        for(auto& item : planar_tensor)
+        {
+            item = rand()%value_range - 128;
+        }
+
+        planar_to_channel_last(planar_tensor.data(), tensor.data(), num_filters, mat_size);
+        argmax_tensor(tensor.data(), mat_1.data(), num_filters, mat_size);
+
+        argmax_planar(planar_tensor.data(), mat_2.data(), num_filters, mat_size);
+        comp_vec(mat_1, mat_2);
+        for(const Simd_Isa isa : {Simd_Isa::sse41, Simd_Isa::avx2, Simd_Isa::avx512bw})
+        {
+            if(!simd_isa_supported(isa)) continue;
+            std::fill(mat_2.begin(), mat_2.end(), -1);
+            argmax_planar_simd(planar_tensor.data(), mat_2.data(), num_filters, mat_size, isa);
+            comp_vec(mat_1, mat_2);
+        }
+
+        // wider index types keep the classes past 127, uint8 indices still take the SIMD kernels
+        std::vector<uint16_t> index_1(mat_size);
+        argmax_tensor(tensor.data(), index_1.data(), num_filters, mat_size);
+        std::vector<uint16_t> index_2(mat_size, UINT16_MAX);
+        argmax_planar(planar_tensor.data(), index_2.data(), num_filters, mat_size);
+        comp_vec(index_1, index_2);
+        const std::vector<uint8_t> index_3(index_1.begin(), index_1.end());
+        std::vector<uint8_t> index_4(mat_size, 255);
+        argmax_planar_simd(planar_tensor.data(), index_4.data(), num_filters, mat_size);
+        comp_vec(index_3, index_4);
+        for(const Simd_Isa isa : {Simd_Isa::sse41, Simd_Isa::avx2, Simd_Isa::avx512bw})
+        {
+            if(!simd_isa_supported(isa)) continue;
+            std::fill(index_4.begin(), index_4.end(), 255);
+            argmax_planar_simd(planar_tensor.data(), index_4.data(), num_filters, mat_size, isa);
+            comp_vec(index_3, index_4);
+        }
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"C : "<< num_columns<<" | ";
+        std::cout<<"R : "<< num_rows<<" | ";
+        std::cout<<"F : "<< num_filters<<std::endl;
+    }
+}
+
+// wake-up latency (assign -> task start) and CPU burnt by the pool between frames for each idle policy
+void idle_policy_benchmark(const unsigned int cycles, const unsigned int idle_ms)
+{
+    typedef std::chrono::steady_clock clock_type;
+    const std::pair<obj_detect::Idle_Policy, std::string> policies[] = {
+        {obj_detect::Idle_Policy::spin, "spin"},
+        {obj_detect::Idle_Policy::spin_then_park, "spin then park"},
+        {obj_detect::Idle_Policy::park, "park"}};
+
+    std::cout << std::left << std::setw(20) << "Idle policy"
+        << std::left << std::setw(25) << "Wake-up latency (us)"
+        << std::left << std::setw(25) << "Round trip (us)"
+        << std::left << std::setw(25) << "Idle CPU (% of a core)"
+        << std::endl;
+
+    for(const auto& policy : policies)
+    {
+        obj_detect::Thread_Pool thread_pool(NUM_THREADS, policy.first);
+        double wake_up_us = 0.0;
+        double round_trip_us = 0.0;
+        double idle_cpu_ms = 0.0;
+        double idle_wall_ms = 0.0;
+        for(unsigned int c=0; c<cycles; c++)
+        {
+            // let the workers settle into their idle state, only the pool runs while the caller sleeps
+            const std::clock_t cpu_1 = std::clock();
+            const auto wall_1 = clock_type::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(idle_ms));
+            const std::clock_t cpu_2 = std::clock();
+            const auto wall_2 = clock_type::now();
+            idle_cpu_ms += 1000.0 * (cpu_2 - cpu_1) / CLOCKS_PER_SEC;
+            idle_wall_ms += std::chrono::duration<double, std::milli>(wall_2 - wall_1).count();
+
+            clock_type::time_point task_start;
+            const auto assigned = clock_type::now();
+            thread_pool.assign([&task_start](){ task_start = clock_type::now(); });
+            thread_pool.wait_until(1);
+            const auto done = clock_type::now();
+            wake_up_us += std::chrono::duration<double, std::micro>(task_start - assigned).count();
+            round_trip_us += std::chrono::duration<double, std::micro>(done - assigned).count();
+        }
+        std::cout << std::left << std::setw(20) << policy.second
+            << std::left << std::setw(25) << wake_up_us / cycles
+            << std::left << std::setw(25) << round_trip_us / cycles
+            << std::left << std::setw(25) << 100.0 * idle_cpu_ms / idle_wall_ms
+            << std::endl;
+    }
+}
+
+// thousands of one-row argmax tasks, submitted from the caller (ext) or fanned out from inside the workers (nested)
+void scheduler_benchmark(const unsigned int num_tasks, const unsigned int cycles, unsigned const int seed)
+{
+    const unsigned int num_columns = 224;
+    const unsigned int num_filters = 21;
+    const unsigned int row_size = num_columns * num_filters;
+
+    std::vector<int8_t> tensor(num_tasks * row_size);
+    std::vector<int8_t> mat(num_tasks * num_columns);
+    srand(seed);
+    fill_vec(tensor);
+    const auto row_task = [&](const unsigned int r){
+        argmax_row(tensor.data() + r*row_size, mat.data() + r*num_columns, num_filters, num_columns);
+    };
+
+    const std::pair<obj_detect::Scheduler, std::string> schedulers[] = {
+        {obj_detect::Scheduler::shared_queue, "Mutex queue"},
+        {obj_detect::Scheduler::work_stealing, "Work stealing"},
+        {obj_detect::Scheduler::lock_free_queue, "Lock-free ring"}};
+
+    for(const unsigned int num_threads : {1, 2, 4, 8, 16, 32})
+    {
+        const std::string threads = (num_threads < 10 ? "-T0" : "-T") + std::to_string(num_threads);
+        for(const auto& scheduler : schedulers)
+        {
+            obj_detect::Thread_Pool thread_pool(num_threads, scheduler.first, obj_detect::Idle_Policy::spin_then_park);
+            const Timer_Key ext_key = Timer::Get().key(scheduler.second + " ext" + threads);
+            const Timer_Key nested_key = Timer::Get().key(scheduler.second + " nested" + threads);
+            for(unsigned int c=0; c<cycles; c++)
+            {
+                Timer::Get().start(ext_key);
+                obj_detect::Task_Group ext_group(thread_pool);
+                for(unsigned int r=0; r<num_tasks; r++)
+                {
+                    ext_group.run([&row_task, r](){ row_task(r); });
+                }
+                ext_group.wait();
+                Timer::Get().stop();
+
+                Timer::Get().start(nested_key);
+                obj_detect::Task_Group nested_group(thread_pool);
+                for(unsigned int w=0; w<num_threads; w++)
+                {
+                    nested_group.run([&row_task, &nested_group, w, num_tasks, num_threads](){
+                        for(unsigned int r=w; r<num_tasks; r+=num_threads)
+                        {
+                            nested_group.run([&row_task, r](){ row_task(r); });
+                        }
+                    });
+                }
+                nested_group.wait();
+                Timer::Get().stop();
+            }
+        }
+    }
+}
+
+void test_work_stealing()
+{
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_theads = rand()%15 + 1;
+        const unsigned int num_columns = rand()%200 + 1;
+        const unsigned int num_rows = rand()%200 + 1;
+        const unsigned int num_filters = rand()%127 + 1;
+        const unsigned int row_size = num_columns*num_filters;
+
+        obj_detect::Thread_Pool thread_pool(num_theads, obj_detect::Scheduler::work_stealing);
+        std::vector<int8_t> tensor(num_rows*row_size);
+        std::vector<int8_t> mat_1(num_rows*num_columns);
+        std::vector<int8_t> mat_2(num_rows*num_columns);
+        std::vector<int8_t> mat_3(num_rows*num_columns);
+
+        fill_vec(tensor);
+        argmax_tensor(tensor.data(), mat_1.data(), num_filters, num_rows*num_columns);
+
+        obj_detect::Task_Group ext_group(thread_pool);
+        for(unsigned int r=0; r<num_rows; r++)
+        {
+            ext_group.run([&, r](){
+                argmax_tensor(tensor.data() + r*row_size, mat_2.data() + r*num_columns, num_filters, num_columns);
+            });
+        }
+        ext_group.wait();
+        comp_vec(mat_1, mat_2);
+
+        // every row task is submitted from inside a worker, so it lands on that worker's own deque
+        const auto row_task = [&](const unsigned int r){
+            argmax_tensor(tensor.data() + r*row_size, mat_3.data() + r*num_columns, num_filters, num_columns);
+        };
+        obj_detect::Task_Group nested_group(thread_pool);
+        nested_group.run([&row_task, &nested_group, num_rows](){
+            for(unsigned int r=0; r<num_rows; r++)
+            {
+                nested_group.run([&row_task, r](){ row_task(r); });
+            }
+        });
+        nested_group.wait();
+        comp_vec(mat_1, mat_3);
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"T : "<< num_theads<<" | ";
+        std::cout<<"C : "<< num_columns<<" | ";
+        std::cout<<"R : "<< num_rows<<" | ";
+        std::cout<<"F : "<< num_filters<<std::endl;
+    }
+}
+
+// two callers share one pool, each with its own Task_Group, and one group runs more than 65535 tasks
+void test_task_group()
+{
+    for(const obj_detect::Scheduler scheduler : {obj_detect::Scheduler::shared_queue, obj_detect::Scheduler::work_stealing, obj_detect::Scheduler::lock_free_queue})
+    {
+        obj_detect::Thread_Pool thread_pool(NUM_THREADS, scheduler, obj_detect::Idle_Policy::spin_then_park);
+        bool mismatch[2] = {false, false};
+        auto stream = [&thread_pool, &mismatch](const unsigned int stream_index){
+            const unsigned int num_filters = 21;
+            const unsigned int mat_size = 28*28;
+            std::vector<int8_t> tensor(mat_size*num_filters);
+            std::vector<int8_t> mat_1(mat_size);
+            std::vector<int8_t> mat_2(mat_size);
+            for(unsigned int c=0; c<200; c++)
+            {
+                for(auto& item : tensor) item = rand()%256 - 128;
+                argmax_tensor(tensor.data(), mat_1.data(), num_filters, mat_size);
+                argmax_tensor_mt(tensor.data(), mat_2.data(), num_filters, mat_size, thread_pool);
+                if(mat_1 != mat_2) mismatch[stream_index] = true;
+            }
+        };
+        std::thread stream_0(stream, 0);
+        std::thread stream_1(stream, 1);
+        stream_0.join();
+        stream_1.join();
+        if(mismatch[0] || mismatch[1]) std::cerr<<"value mismatch : shared pool streams\n";
+
+        const unsigned int num_tasks = 70000;
+        std::atomic_uint count(0);
+        obj_detect::Task_Group task_group(thread_pool);
+        for(unsigned int i=0; i<num_tasks; i++)
+        {
+            task_group.run([&count](){ count++; });
+        }
+        task_group.wait();
+        if(count != num_tasks) std::cerr<<"task count mismatch : "<< count << " != " << num_tasks <<std::endl;
+    }
+}
+
+void test_parallel_for()
+{
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_theads = rand()%15 + 1;
+        const unsigned int begin = rand()%100;
+        const unsigned int end = begin + rand()%5000;
+        const unsigned int grain = rand()%64;
+
+        obj_detect::Thread_Pool thread_pool(num_theads);
+        for(const obj_detect::Partition partition : {obj_detect::Partition::static_chunks, obj_detect::Partition::dynamic, obj_detect::Partition::guided})
+        {
+            // every index must be visited exactly once
+            std::vector<std::atomic_uint> visits(end);
+            for(auto& v : visits) v = 0;
+            thread_pool.parallel_for(begin, end, grain, [&visits](const unsigned int chunk_begin, const unsigned int chunk_end){
+                for(unsigned int k=chunk_begin; k<chunk_end; k++) visits[k]++;
+            }, partition);
+            for(unsigned int k=0; k<end; k++)
+            {
+                if(visits[k] != (k < begin ? 0u : 1u))
+                {
+                    std::cerr<<"parallel_for visit mismatch : index "<< k << " visited " << visits[k] << " times\n";
+                    break;
+                }
+            }
+        }
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"T : "<< num_theads<<" | ";
+        std::cout<<"B : "<< begin<<" | ";
+        std::cout<<"E : "<< end<<" | ";
+        std::cout<<"G : "<< grain<<std::endl;
+    }
+}
+
+void test_zero_alloc_frame()
+{
+    const unsigned int num_rows = 28;
+    const unsigned int num_columns = 28;
+    const unsigned int num_filters = 21;
+    const unsigned int scale_up_factor = 8;
+    const unsigned int mat_size = num_rows * num_columns;
+
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS, obj_detect::Scheduler::lock_free_queue, obj_detect::Idle_Policy::spin_then_park);
+    std::vector<int8_t> tensor(mat_size * num_filters);
+    std::vector<int8_t> mat(mat_size);
+    std::vector<int8_t> scaled_up_mat(mat_size * scale_up_factor * scale_up_factor);
+    fill_vec(tensor);
+
+    auto frame = [&](){
+        argmax_tensor_mt(tensor.data(), mat.data(), num_filters, mat_size, thread_pool);
+        argmax_tensor_mt(tensor.data(), mat.data(), num_filters, mat_size, thread_pool, obj_detect::Partition::guided, num_columns);
+        argmax_up_scale_mt(tensor.data(), scaled_up_mat.data(), num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+    };
+
+    for(unsigned int c=0; c<10; c++) frame();
+    const unsigned long num_allocations = g_num_allocations;
+    const unsigned int num_frames = 100;
+    for(unsigned int c=0; c<num_frames; c++) frame();
+    const unsigned long frame_allocations = g_num_allocations - num_allocations;
+    std::cout<<"Heap allocations per frame : "<< (double)frame_allocations / num_frames <<std::endl;
+    if(frame_allocations != 0) std::cerr<<"allocation mismatch : "<< frame_allocations << " != 0\n";
+
+    // backpressure, a 4 slot ring behind a blocked worker takes 4 tasks and then refuses
+    obj_detect::Thread_Pool small_pool(1, obj_detect::Scheduler::lock_free_queue, obj_detect::Idle_Policy::park, 0, 2);
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    small_pool.assign([&started, &release](){
+        started = true;
+        while(!release) std::this_thread::yield();
+    });
+    while(!started) std::this_thread::yield();
+    unsigned int num_accepted = 0;
+    while(small_pool.try_assign([](){})) num_accepted++;
+    if(num_accepted != 4) std::cerr<<"backpressure mismatch : "<< num_accepted << " != 4\n";
+    release = true;
+    small_pool.wait_until(num_accepted + 1);
+
+    // a blocking assign() on a full ring makes progress by running queued tasks itself
+    std::atomic_uint count(0);
+    obj_detect::Task_Group task_group(small_pool);
+    for(unsigned int i=0; i<1000; i++) task_group.run([&count](){ count++; });
+    task_group.wait();
+    if(count != 1000) std::cerr<<"task count mismatch : "<< count << " != 1000\n";
+}
+
+void test_upsampler_mt()
+{
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_rows = rand()%60 + 1;
+        const unsigned int num_columns = rand()%60 + 1;
+        const unsigned int num_filters = (i%2 == 0) ? 1 : rand()%30 + 1;
+        // even iterations use integer factors, odd ones arbitrary (possibly shrinking) target sizes
+        const unsigned int scale_up_factor = rand()%9 + 1;
+        const unsigned int scaled_up_num_rows = (i%4 < 2) ? num_rows * scale_up_factor : rand()%500 + 1;
+        const unsigned int scaled_up_num_columns = (i%4 < 2) ? num_columns * scale_up_factor : rand()%700 + 1;
+
+        std::vector<int8_t> tensor(num_rows * num_columns * num_filters);
+        std::vector<int8_t> new_tensor_1(scaled_up_num_rows * scaled_up_num_columns * num_filters);
+        std::vector<int8_t> new_tensor_2(new_tensor_1.size());
+        fill_vec(tensor);
+
+        // reference nearest-neighbour mapping
+        for(unsigned int y=0; y<scaled_up_num_rows; y++)
+        {
+            const unsigned int r = (unsigned int)((unsigned long long)y * num_rows / scaled_up_num_rows);
+            for(unsigned int x=0; x<scaled_up_num_columns; x++)
+            {
+                const unsigned int c = (unsigned int)((unsigned long long)x * num_columns / scaled_up_num_columns);
+                memcpy(&new_tensor_1[(y * scaled_up_num_columns + x) * num_filters], &tensor[(r * num_columns + c) * num_filters], num_filters);
+            }
+        }
+        if(i%4 < 2)
+        {
+            std::vector<int8_t> new_tensor_3(new_tensor_1.size());
+            upsampler(tensor.data(), new_tensor_3.data(), num_rows, num_columns, num_filters, scale_up_factor);
+            comp_vec(new_tensor_1, new_tensor_3);
+        }
+
+        const Upsample_Plan plan = make_upsample_plan(num_rows, num_columns, scaled_up_num_rows, scaled_up_num_columns);
+        upsampler_mt(tensor.data(), new_tensor_2.data(), plan, num_filters, thread_pool);
+        comp_vec(new_tensor_1, new_tensor_2);
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"R : "<< num_rows<<" -> "<< scaled_up_num_rows<<" | ";
+        std::cout<<"C : "<< num_columns<<" -> "<< scaled_up_num_columns<<" | ";
+        std::cout<<"F : "<< num_filters<<std::endl;
+    }
+}
+
+void test_bilinear_argmax()
+{
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_rows = rand()%40 + 1;
+        const unsigned int num_columns = rand()%40 + 1;
+        // every third run takes more classes than an int8 index holds
+        const unsigned int num_filters = (i%3 == 2) ? rand()%128 + 129 : rand()%40 + 1;
+        const unsigned int scaled_up_num_rows = (i%2 == 0) ? num_rows * (rand()%8 + 1) : rand()%300 + 1;
+        const unsigned int scaled_up_num_columns = (i%2 == 0) ? num_columns * (rand()%8 + 1) : rand()%300 + 1;
+        const unsigned int scaled_up_mat_size = scaled_up_num_rows * scaled_up_num_columns;
+
+        std::vector<int8_t> tensor(num_rows * num_columns * num_filters);
+        std::vector<int8_t> mat_1(scaled_up_mat_size);
+        std::vector<int8_t> mat_2(scaled_up_mat_size);
+        fill_vec(tensor);
+
+        const Bilinear_Plan plan = make_bilinear_plan(num_rows, num_columns, scaled_up_num_rows, scaled_up_num_columns);
+        const unsigned int tensor_row_size = num_columns * num_filters;
+        for(unsigned int y=0; y<scaled_up_num_rows; y++)
+        {
+            const int8_t* const row0_ptr = tensor.data() + plan.row_index[y] * tensor_row_size;
+            bilinear_argmax_row<int8_t>(
+                row0_ptr, plan.row_weight[y] > 0 ? row0_ptr + tensor_row_size : row0_ptr, plan.row_weight[y],
+                mat_1.data() + y * scaled_up_num_columns, num_filters, num_columns, scaled_up_num_columns,
+                plan.column_index.data(), plan.column_weight.data());
+        }
+        bilinear_argmax_mt(tensor.data(), mat_2.data(), plan, num_filters, thread_pool);
+        comp_vec(mat_1, mat_2);
+
+        // wider index types keep the classes past 127, uint8 indices still take the SIMD kernel
+        std::vector<uint16_t> index_1(scaled_up_mat_size);
+        for(unsigned int y=0; y<scaled_up_num_rows; y++)
+        {
+            const int8_t* const row0_ptr = tensor.data() + plan.row_index[y] * tensor_row_size;
+            bilinear_argmax_row<int8_t, uint16_t>(
+                row0_ptr, plan.row_weight[y] > 0 ? row0_ptr + tensor_row_size : row0_ptr, plan.row_weight[y],
+                index_1.data() + y * scaled_up_num_columns, num_filters, num_columns, scaled_up_num_columns,
+                plan.column_index.data(), plan.column_weight.data());
+        }
+        const std::vector<uint8_t> index_2(mat_1.begin(), mat_1.end());
+        comp_vec(index_2, std::vector<uint8_t>(index_1.begin(), index_1.end()));
+        std::vector<uint16_t> index_3(scaled_up_mat_size, UINT16_MAX);
+        bilinear_argmax_mt(tensor.data(), index_3.data(), plan, num_filters, thread_pool);
+        comp_vec(index_1, index_3);
+        std::vector<uint8_t> index_4(scaled_up_mat_size, 255);
+        bilinear_argmax_mt(tensor.data(), index_4.data(), plan, num_filters, thread_pool);
+        comp_vec(index_2, index_4);
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"R : "<< num_rows<<" -> "<< scaled_up_num_rows<<" | ";
+        std::cout<<"C : "<< num_columns<<" -> "<< scaled_up_num_columns<<" | ";
+        std::cout<<"F : "<< num_filters<<std::endl;
+    }
+
+    // without a size change every sample lands on a source pixel and the result is the plain argmax
+    std::vector<int8_t> tensor(28 * 28 * 21);
+    std::vector<int8_t> mat_1(28 * 28);
+    std::vector<int8_t> mat_2(28 * 28);
+    fill_vec(tensor);
+    argmax_tensor(tensor.data(), mat_1.data(), 21, 28 * 28);
+    bilinear_argmax_mt(tensor.data(), mat_2.data(), make_bilinear_plan(28, 28, 28, 28), 21, thread_pool);
+    comp_vec(mat_1, mat_2);
+}
+
+// frames/s of 28x28x21 -> 224x224 masks, one call (and one barrier) per frame against one call for the whole batch
+void batch_benchmark(const unsigned int cycles, unsigned const int seed)
+{
+    typedef std::chrono::steady_clock clock_type;
+    const unsigned int num_rows = 28;
+    const unsigned int num_columns = 28;
+    const unsigned int num_filters = 21;
+    const unsigned int scale_up_factor = 8;
+    const unsigned int frame_size = num_rows * num_columns * num_filters;
+    const unsigned int scaled_up_mat_size = num_rows * scale_up_factor * num_columns * scale_up_factor;
+    const Bilinear_Plan plan = make_bilinear_plan(num_rows, num_columns, num_rows * scale_up_factor, num_columns * scale_up_factor);
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    srand(seed);
+
+    std::cout << std::left << std::setw(10) << "Frames"
+        << std::left << std::setw(25) << "Per frame (frames/s)"
+        << std::left << std::setw(25) << "Batched (frames/s)"
+        << std::left << std::setw(25) << "Bilinear per frame"
+        << std::left << std::setw(25) << "Bilinear batched"
+        << std::endl;
+
+    for(const unsigned int num_frames : {1, 2, 4, 8, 16, 32, 64})
+    {
+        std::vector<int8_t> tensor(num_frames * frame_size);
+        std::vector<int8_t> scaled_up_mat(num_frames * scaled_up_mat_size);
+        fill_vec(tensor);
+
+        double seconds[4] = {};
+        for(unsigned int c=0; c<cycles; c++)
+        {
+            auto t_1 = clock_type::now();
+            for(unsigned int n=0; n<num_frames; n++)
+            {
+                argmax_up_scale_mt(tensor.data() + n * frame_size, scaled_up_mat.data() + n * scaled_up_mat_size,
+                    num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+            }
+            auto t_2 = clock_type::now();
+            seconds[0] += std::chrono::duration<double>(t_2 - t_1).count();
+
+            t_1 = clock_type::now();
+            argmax_up_scale_batch_mt(tensor.data(), scaled_up_mat.data(), num_frames, num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+            t_2 = clock_type::now();
+            seconds[1] += std::chrono::duration<double>(t_2 - t_1).count();
+
+            t_1 = clock_type::now();
+            for(unsigned int n=0; n<num_frames; n++)
+            {
+                bilinear_argmax_mt(tensor.data() + n * frame_size, scaled_up_mat.data() + n * scaled_up_mat_size, plan, num_filters, thread_pool);
+            }
+            t_2 = clock_type::now();
+            seconds[2] += std::chrono::duration<double>(t_2 - t_1).count();
+
+            t_1 = clock_type::now();
+            bilinear_argmax_batch_mt(tensor.data(), scaled_up_mat.data(), num_frames, plan, num_filters, thread_pool);
+            t_2 = clock_type::now();
+            seconds[3] += std::chrono::duration<double>(t_2 - t_1).count();
+        }
+
+        std::cout << std::left << std::setw(10) << num_frames;
+        for(const double s : seconds)
+        {
+            std::cout << std::left << std::setw(25) << (double)num_frames * cycles / s;
+        }
+        std::cout << std::endl;
+    }
+}
+
+void test_batch()
+{
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_frames = rand()%8 + 1;
+        const unsigned int num_rows = rand()%40 + 1;
+        const unsigned int num_columns = rand()%40 + 1;
+        const unsigned int num_filters = rand()%40 + 1;
+        const unsigned int scale_up_factor = rand()%8 + 1;
+        const unsigned int frame_size = num_rows * num_columns * num_filters;
+        const unsigned int mat_size = num_rows * num_columns;
+        const unsigned int scaled_up_mat_size = mat_size * scale_up_factor * scale_up_factor;
+
+        std::vector<int8_t> tensor(num_frames * frame_size);
+        fill_vec(tensor);
+
+        // every batched entry point against a loop of single frame calls
+        std::vector<int8_t> mat_1(num_frames * mat_size);
+        std::vector<int8_t> mat_2(num_frames * mat_size);
+        for(unsigned int n=0; n<num_frames; n++)
+        {
+            argmax_tensor(tensor.data() + n * frame_size, mat_1.data() + n * mat_size, num_filters, mat_size);
+        }
+        argmax_tensor_batch_mt(tensor.data(), mat_2.data(), num_frames, num_filters, mat_size, thread_pool, rand()%300 + 1);
+        comp_vec(mat_1, mat_2);
+
+        std::vector<int8_t> scaled_up_mat_1(num_frames * scaled_up_mat_size);
+        std::vector<int8_t> scaled_up_mat_2(num_frames * scaled_up_mat_size);
+        for(unsigned int n=0; n<num_frames; n++)
+        {
+            argmax_up_scale_mt(tensor.data() + n * frame_size, scaled_up_mat_1.data() + n * scaled_up_mat_size,
+                num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+        }
+        argmax_up_scale_batch_mt(tensor.data(), scaled_up_mat_2.data(), num_frames, num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+        comp_vec(scaled_up_mat_1, scaled_up_mat_2);
+
+        const Bilinear_Plan bilinear_plan = make_bilinear_plan(num_rows, num_columns, num_rows * scale_up_factor, num_columns * scale_up_factor);
+        for(unsigned int n=0; n<num_frames; n++)
+        {
+            bilinear_argmax_mt(tensor.data() + n * frame_size, scaled_up_mat_1.data() + n * scaled_up_mat_size, bilinear_plan, num_filters, thread_pool);
+        }
+        bilinear_argmax_batch_mt(tensor.data(), scaled_up_mat_2.data(), num_frames, bilinear_plan, num_filters, thread_pool);
+        comp_vec(scaled_up_mat_1, scaled_up_mat_2);
+
+        std::vector<int8_t> scaled_up_tensor_1(num_frames * scaled_up_mat_size * num_filters);
+        std::vector<int8_t> scaled_up_tensor_2(num_frames * scaled_up_mat_size * num_filters);
+        const Upsample_Plan upsample_plan = make_upsample_plan_scaled(num_rows, num_columns, scale_up_factor, scale_up_factor);
+        for(unsigned int n=0; n<num_frames; n++)
+        {
+            upsampler(tensor.data() + n * frame_size, scaled_up_tensor_1.data() + n * scaled_up_mat_size * num_filters,
+                num_rows, num_columns, num_filters, scale_up_factor);
+        }
+        upsampler_batch_mt(tensor.data(), scaled_up_tensor_2.data(), num_frames, upsample_plan, num_filters, thread_pool);
+        comp_vec(scaled_up_tensor_1, scaled_up_tensor_2);
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"N : "<< num_frames<<" | ";
+        std::cout<<"R : "<< num_rows<<" | ";
+        std::cout<<"C : "<< num_columns<<" | ";
+        std::cout<<"F : "<< num_filters<<" | ";
+        std::cout<<"S : "<< scale_up_factor<<std::endl;
+    }
+}
+
+// one camera frame of the postprocessing pipeline, every buffer is allocated once per slot.
+// the masks are kept packed, 5 bits per pixel for the 21 classes
+struct Postprocess_Frame
+{
+    std::vector<int8_t> tensor;
+    std::vector<uint8_t> mat;
+    std::vector<uint8_t> scaled_up_mat;
+    uint32_t checksum = 0;
+};
+
+// decode -> argmax -> upsample -> sink stages on 28x28x21 logits, the decode stage makes up a frame from its id
+struct Postprocess_Stages
+{
+    static const unsigned int num_rows = 28;
+    static const unsigned int num_columns = 28;
+    static const unsigned int num_filters = 21;
+    static const unsigned int scale_up_factor = 8;
+    static const unsigned int mask_bits = 5;
+
+    static void init(Postprocess_Frame& frame)
+    {
+        frame.tensor.resize(num_rows * num_columns * num_filters);
+        frame.mat.resize(packed_mask_size(num_rows * num_columns, mask_bits));
+        frame.scaled_up_mat.resize(packed_mask_size(num_rows * num_columns * scale_up_factor * scale_up_factor, mask_bits));
+    }
+
+    static void decode(Postprocess_Frame& frame, const uint64_t frame_id)
+    {
+        uint32_t state = 2654435761u * (uint32_t)(frame_id + 1);
+        for(auto& item : frame.tensor)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            item = (int8_t)(state >> 24);
+        }
+    }
+
+    static void argmax(Postprocess_Frame& frame, const uint64_t)
+    {
+        argmax_packed_row(frame.tensor.data(), frame.mat.data(), 0, num_rows * num_columns, num_filters, mask_bits);
+    }
+
+    static void up_scale(Postprocess_Frame& frame, const uint64_t)
+    {
+        upsampler_packed(frame.mat.data(), frame.scaled_up_mat.data(), num_rows, num_columns, scale_up_factor, mask_bits);
+    }
+
+    static void sink(Postprocess_Frame& frame, const uint64_t)
+    {
+        uint32_t checksum = 0;
+        for(const uint8_t item : frame.scaled_up_mat) checksum = checksum * 31 + item;
+        frame.checksum = checksum;
+    }
+};
+
+template <typename Frame>
+void add_postprocess_stages(obj_detect::Frame_Pipeline<Frame>& pipeline, std::vector<uint32_t>& checksums)
+{
+    pipeline.for_each_frame(Postprocess_Stages::init);
+    pipeline.add_stage("decode", Postprocess_Stages::decode);
+    pipeline.add_stage("argmax", Postprocess_Stages::argmax);
+    pipeline.add_stage("up scale", Postprocess_Stages::up_scale);
+    pipeline.add_stage("sink", [&checksums](Postprocess_Frame& frame, const uint64_t frame_id){
+        Postprocess_Stages::sink(frame, frame_id);
+        checksums[frame_id % checksums.size()] = frame.checksum;
+    });
+}
+
+// sequential per-frame postprocessing against the same stages overlapped in a Frame_Pipeline
+// trace_prefix set traces the backpressure run to <trace_prefix>.json and its aggregates to <trace_prefix>.csv
+void pipeline_benchmark(const unsigned int num_frames, const unsigned int num_slots, const std::string& trace_prefix = "")
+{
+    typedef std::chrono::steady_clock clock_type;
+    std::vector<uint32_t> checksums(num_frames);
+
+    Postprocess_Frame frame;
+    Postprocess_Stages::init(frame);
+    const auto sequential_start = clock_type::now();
+    for(unsigned int i=0; i<num_frames; i++)
+    {
+        Postprocess_Stages::decode(frame, i);
+        Postprocess_Stages::argmax(frame, i);
+        Postprocess_Stages::up_scale(frame, i);
+        Postprocess_Stages::sink(frame, i);
+        checksums[i] = frame.checksum;
+    }
+    const double sequential_s = std::chrono::duration<double>(clock_type::now() - sequential_start).count();
+    std::cout << "Sequential : " << num_frames / sequential_s << " frames/s" << std::endl;
+
+    const std::pair<obj_detect::Overflow_Policy, std::string> policies[] = {
+        {obj_detect::Overflow_Policy::backpressure, "backpressure"},
+        {obj_detect::Overflow_Policy::drop_oldest, "drop oldest"}};
+    for(const auto& policy : policies)
+    {
+        // the backpressure run is traced when asked, every stage on the track of the worker that ran it
+        const bool traced = !trace_prefix.empty() && policy.first == obj_detect::Overflow_Policy::backpressure;
+        Fast_Timer::Get().reset();
+        Probe::enable(traced);
+        obj_detect::Thread_Pool thread_pool(NUM_THREADS, obj_detect::Idle_Policy::spin_then_park);
+        obj_detect::Frame_Pipeline<Postprocess_Frame> pipeline(thread_pool, num_slots, policy.first, num_frames);
+        std::vector<uint32_t> pipeline_checksums(num_frames);
+        add_postprocess_stages(pipeline, pipeline_checksums);
+
+        // backpressure runs flat out, drop oldest is fed like a camera at twice the sequential frame rate
+        const double push_interval_s = policy.first == obj_detect::Overflow_Policy::drop_oldest ? sequential_s / num_frames / 2 : 0.0;
+        const auto pipeline_start = clock_type::now();
+        for(unsigned int i=0; i<num_frames; i++)
+        {
+            while(std::chrono::duration<double>(clock_type::now() - pipeline_start).count() < i * push_interval_s) std::this_thread::yield();
+            pipeline.push();
+        }
+        pipeline.flush();
+        const double pipeline_s = std::chrono::duration<double>(clock_type::now() - pipeline_start).count();
+        Probe::enable(false);
+        if(traced && Fast_Timer::Get().write_chrome_trace(trace_prefix + ".json") && Fast_Timer::Get().write_csv(trace_prefix + ".csv"))
+        {
+            std::cout << "Trace written to " << trace_prefix << ".json, aggregates to " << trace_prefix << ".csv" << std::endl;
+        }
+        Fast_Timer::Get().reset();
+
+        std::cout << "Pipeline " << policy.second << " : " << pipeline.get_num_completed() / pipeline_s << " frames/s"
+            << " | dropped " << pipeline.get_num_dropped()
+            << " | latency p50 " << pipeline.latency_percentile(50) << " us"
+            << " | p99 " << pipeline.latency_percentile(99) << " us" << std::endl;
+        for(const auto& stage : pipeline.get_stage_stats())
+        {
+            std::cout << "    " << std::left << std::setw(12) << stage.name
+                << std::left << std::setw(12) << stage.frames
+                << std::left << std::setw(25) << (stage.busy_ms > 0 ? 1000.0 * stage.frames / stage.busy_ms : 0.0)
+                << "frames/s" << std::endl;
+        }
+    }
+}
+
+void test_pipeline()
+{
+    const unsigned int num_frames = 300;
+    std::vector<uint32_t> checksums(num_frames);
+    Postprocess_Frame frame;
+    Postprocess_Stages::init(frame);
+    for(unsigned int i=0; i<num_frames; i++)
+    {
+        Postprocess_Stages::decode(frame, i);
+        Postprocess_Stages::argmax(frame, i);
+        Postprocess_Stages::up_scale(frame, i);
+        Postprocess_Stages::sink(frame, i);
+        checksums[i] = frame.checksum;
+    }
+
+    for(unsigned int i=0; i<6; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_threads = rand()%8 + 1;
+        const unsigned int num_slots = rand()%8 + 1;
+        const bool drop = i%2 == 1;
+        obj_detect::Thread_Pool thread_pool(num_threads, obj_detect::Scheduler(i%3), obj_detect::Idle_Policy::spin_then_park);
+        std::vector<uint32_t> pipeline_checksums(num_frames, 0);
+        std::vector<uint64_t> sink_order;
+        sink_order.reserve(num_frames);
+        {
+            obj_detect::Frame_Pipeline<Postprocess_Frame> pipeline(thread_pool, num_slots,
+                drop ? obj_detect::Overflow_Policy::drop_oldest : obj_detect::Overflow_Policy::backpressure);
+            add_postprocess_stages(pipeline, pipeline_checksums);
+            pipeline.add_stage("order", [&sink_order](Postprocess_Frame&, const uint64_t frame_id){ sink_order.push_back(frame_id); });
+            unsigned int num_dropped = 0;
+            for(unsigned int f=0; f<num_frames; f++)
+            {
+                if(!pipeline.push()) num_dropped++;
+            }
+            pipeline.flush();
+            if(pipeline.get_num_completed() + pipeline.get_num_dropped() != num_frames || num_dropped != pipeline.get_num_dropped())
+            {
+                std::cerr<<"pipeline lost frames : "<< pipeline.get_num_completed()<< " + " << pipeline.get_num_dropped() << " != " << num_frames <<std::endl;
+            }
+            if(!drop && pipeline.get_num_dropped() != 0) std::cerr<<"backpressure pipeline dropped frames"<<std::endl;
+        }
+
+        // frames leave in push order and every completed frame matches the sequential result
+        for(unsigned int k=1; k<sink_order.size(); k++)
+        {
+            if(sink_order[k] <= sink_order[k-1]) std::cerr<<"pipeline order mismatch : "<< sink_order[k-1]<< " -> " << sink_order[k] <<std::endl;
+        }
+        for(const uint64_t frame_id : sink_order)
+        {
+            if(checksums[frame_id] != pipeline_checksums[frame_id]) std::cerr<<"pipeline value mismatch at frame "<< frame_id <<std::endl;
+        }
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"T : "<< num_threads<<" | ";
+        std::cout<<"S : "<< num_slots<<" | ";
+        std::cout<<"Completed : "<< sink_order.size()<<std::endl;
+    }
+}
+
+// the original text loader (getline per line, regex on the header, stof per value), kept as the reference
+void vector_populator_legacy(const std::string name, std::vector<int8_t>& vec)
+{
+    std::vector<std::string> arr;
+    std::ifstream file(name);
+    if (!file.is_open()) return;
+    std::string str;
+    while (getline(file, str))
+    {
+        arr.push_back(str);
+    }
+
+    std::string s = arr[0];
+    int str_start = s.find("(") + 1;
+    int str_end = s.find(")") - str_start;
+    std::string token = std::regex_replace(s.substr(str_start, str_end), std::regex(","), "");
+    std::vector<int> dim_array;
+    std::stringstream sstream(token);
+    int temp;
+    while (sstream >> temp)
+        dim_array.push_back(temp);
+
+    int count = 1;
+    for (int n = 0; n < dim_array[0] * dim_array[1] * dim_array[2] * dim_array[3]; n++) {
+        vec.push_back(std::stof(arr[count]));
+        count++;
+    }
+}
+
+// text dump loaders against the mapped tensor file of the same data, the tensor files are scratch files removed at the end
+void tensor_load_benchmark(const std::string& data_dir, const unsigned int cycles)
+{
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    for(const std::string name : {"o_62", "o_64"})
+    {
+        const std::string text_path = data_dir + "/" + name + ".txt";
+        const std::string tensor_path = "test_tensor_load_" + name + ".bin";
+        if(!convert_text_dump(text_path, tensor_path)) continue;
+
+        std::vector<int8_t> legacy_vec;
+        std::vector<int8_t> vec;
+        std::vector<int8_t> mt_vec;
+        Mapped_Tensor tensor;
+        const Timer_Key legacy_key = Timer::Get().key("Load txt legacy-" + name);
+        const Timer_Key text_key = Timer::Get().key("Load txt-" + name);
+        const Timer_Key text_mt_key = Timer::Get().key("Load txt MT-" + name);
+        const Timer_Key tensor_key = Timer::Get().key("Load bin-" + name);
+        for(unsigned int c=0; c<cycles; c++)
+        {
+            legacy_vec.clear();
+            unsigned int width = 0;
+            unsigned int height = 0;
+            unsigned int channel = 0;
+            Timer::Get().start(legacy_key);
+            vector_populator_legacy(text_path, legacy_vec);
+            Timer::Get().stop();
+
+            Timer::Get().start(text_key);
+            vector_populator(text_path, vec, width, height, channel);
+            Timer::Get().stop();
+
+            Timer::Get().start(text_mt_key);
+            vector_populator(text_path, mt_vec, width, height, channel, &thread_pool);
+            Timer::Get().stop();
+
+            Timer::Get().start(tensor_key);
+            tensor.open(tensor_path);
+            Timer::Get().stop();
+        }
+
+        comp_vec(legacy_vec, vec);
+        comp_vec(legacy_vec, mt_vec);
+        if(tensor.num_elements() != vec.size() || memcmp(tensor.data(), vec.data(), vec.size()) != 0)
+        {
+            std::cerr<<"tensor file mismatch : "<< tensor_path <<std::endl;
+        }
+        if((uintptr_t)tensor.data() % 64 != 0) std::cerr<<"tensor file data not aligned : "<< tensor_path <<std::endl;
+        tensor.close();
+        std::remove(tensor_path.c_str());
+    }
+}
+
+void test_text_dump()
+{
+    const std::string path = "test_text_dump.txt";
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    const auto write_dump = [&path](const std::string& header, const std::vector<std::string>& lines){
+        std::ofstream file(path, std::ios::trunc);
+        file << header << "\n";
+        for(const auto& line : lines) file << line << "\n";
+    };
+
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int batch = rand()%3 + 1;
+        const unsigned int rows = rand()%60 + 1;
+        const unsigned int columns = rand()%60 + 1;
+        const unsigned int filters = rand()%30 + 1;
+        std::vector<int8_t> vec(batch * rows * columns * filters);
+        fill_vec(vec);
+        std::vector<std::string> lines;
+        for(const int8_t item : vec) lines.push_back(std::to_string((int)item));
+        write_dump("Layer 0 o (" + std::to_string(batch) + ", " + std::to_string(rows) + ", " + std::to_string(columns) + ", " + std::to_string(filters) + ")", lines);
+
+        std::vector<int8_t> legacy_vec;
+        std::vector<int8_t> parsed_vec;
+        std::vector<int8_t> mt_vec;
+        std::vector<uint32_t> shape;
+        vector_populator_legacy(path, legacy_vec);
+        parse_text_dump(path, parsed_vec, shape);
+        // a small threshold forces the chunked path even on small files
+        parse_text_dump(path, mt_vec, shape, &thread_pool, rand()%4096);
+        comp_vec(vec, legacy_vec);
+        comp_vec(vec, parsed_vec);
+        comp_vec(vec, mt_vec);
+        if(shape != std::vector<uint32_t>{batch, rows, columns, filters}) std::cerr<<"text dump shape mismatch"<<std::endl;
+
+        // one value short, one too many, an unparsable value and one outside int8 are all rejected
+        std::vector<std::vector<std::string>> bad_lines(4, lines);
+        bad_lines[0].pop_back();
+        bad_lines[1].push_back("1");
+        bad_lines[2][rand()%lines.size()] = "12x";
+        bad_lines[3][rand()%lines.size()] = "200";
+        for(const auto& bad : bad_lines)
+        {
+            write_dump("Layer 0 o (" + std::to_string(batch) + ", " + std::to_string(rows) + ", " + std::to_string(columns) + ", " + std::to_string(filters) + ")", bad);
+            if(parse_text_dump(path, parsed_vec, shape) || parse_text_dump(path, mt_vec, shape, &thread_pool, 0) || !parsed_vec.empty())
+            {
+                std::cerr<<"bad text dump accepted"<<std::endl;
+            }
+        }
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"Values : "<< vec.size()<<std::endl;
+    }
+
+    // a header without a shape, or with one larger than the file, is rejected before the body is read
+    std::vector<int8_t> vec;
+    std::vector<uint32_t> shape;
+    write_dump("Layer 0 o", {"1", "2"});
+    if(parse_text_dump(path, vec, shape)) std::cerr<<"text dump without shape accepted"<<std::endl;
+    write_dump("Layer 0 o (100000, 100000, 100000, 100000)", {"1", "2"});
+    if(parse_text_dump(path, vec, shape)) std::cerr<<"oversized text dump accepted"<<std::endl;
+    if(parse_text_dump("missing_text_dump.txt", vec, shape)) std::cerr<<"missing text dump accepted"<<std::endl;
+    std::remove(path.c_str());
+}
+
+void test_tensor_file()
+{
+    const std::string path = "test_tensor_file.bin";
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        std::vector<uint32_t> shape(rand()%4 + 1);
+        for(auto& d : shape) d = rand()%30 + 1;
+        const uint32_t alignment = 1u << (rand()%13);
+        size_t size = 1;
+        for(const auto d : shape) size *= d;
+
+        std::vector<int8_t> vec(size);
+        fill_vec(vec);
+        const Tensor_Layout layout = (i%2 == 0) ? Tensor_Layout::channel_last : Tensor_Layout::planar;
+        if(!write_tensor_file(path, vec.data(), Tensor_Dtype::int8, shape, layout, alignment)) continue;
+
+        Mapped_Tensor tensor;
+        if(!tensor.open(path)) continue;
+        if(tensor.shape() != shape || tensor.layout() != layout || tensor.dtype() != Tensor_Dtype::int8 || tensor.num_elements() != size)
+        {
+            std::cerr<<"tensor file header mismatch"<<std::endl;
+        }
+        if((uintptr_t)tensor.data() % alignment != 0) std::cerr<<"tensor file data not aligned to "<< alignment <<std::endl;
+        comp_vec(vec, std::vector<int8_t>(tensor.data_as<int8_t>(), tensor.data_as<int8_t>() + tensor.num_elements()));
+
+        // a moved-from view is empty and the new owner keeps the mapping alive
+        Mapped_Tensor moved(std::move(tensor));
+        if(tensor.is_open() || !moved.is_open()) std::cerr<<"tensor file move mismatch"<<std::endl;
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"Rank : "<< shape.size()<<" | ";
+        std::cout<<"Size : "<< size<<" | ";
+        std::cout<<"Alignment : "<< alignment<<std::endl;
+    }
+
+    // a truncated file is rejected instead of handing out a pointer past its end
+    std::vector<int8_t> vec(1000);
+    write_tensor_file(path, vec.data(), Tensor_Dtype::int8, {10, 100});
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::ofstream truncated(path, std::ios::binary | std::ios::trunc);
+    truncated.write(bytes.data(), bytes.size() - 1);
+    truncated.close();
+    Mapped_Tensor tensor;
+    if(tensor.open(path)) std::cerr<<"truncated tensor file accepted"<<std::endl;
+
+    // a shape whose element count wraps to the payload size, and a dimension past rank that is not 1, are rejected
+    Tensor_File_Header header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    header.rank = 4;
+    for(unsigned int d=0; d<4; d++) header.shape[d] = 65536;
+    header.data_size = 0;
+    std::vector<char> crafted(bytes);
+    memcpy(crafted.data(), &header, sizeof(header));
+    std::ofstream wrapped(path, std::ios::binary | std::ios::trunc);
+    wrapped.write(crafted.data(), crafted.size());
+    wrapped.close();
+    if(tensor.open(path)) std::cerr<<"overflowing tensor file shape accepted"<<std::endl;
+
+    memcpy(&header, bytes.data(), sizeof(header));
+    header.shape[Tensor_File_Header::max_rank - 1] = 2;
+    memcpy(crafted.data(), &header, sizeof(header));
+    std::ofstream padded(path, std::ios::binary | std::ios::trunc);
+    padded.write(crafted.data(), crafted.size());
+    padded.close();
+    if(tensor.open(path)) std::cerr<<"tensor file with an unused dimension past rank accepted"<<std::endl;
+    std::remove(path.c_str());
+}
+
+// cost of one start/stop pair of the global Timer against Fast_Timer, then Fast_Timer inside argmax_tensor_mt tasks
+void fast_timer_benchmark(const unsigned int iterations, unsigned const int seed)
+{
+    typedef std::chrono::steady_clock clock_type;
+
+    auto t_1 = clock_type::now();
+    for(unsigned int i=0; i<iterations; i++)
+    {
+        Timer::Get().start("Timer overhead");
+        Timer::Get().stop();
+    }
+    auto t_2 = clock_type::now();
+    const double timer_ns = std::chrono::duration<double, std::nano>(t_2 - t_1).count() / iterations;
+
+    const Timer_Key timer_key = Timer::Get().key("Timer key overhead");
+    t_1 = clock_type::now();
+    for(unsigned int i=0; i<iterations; i++)
+    {
+        Timer::Get().start(timer_key);
+        Timer::Get().stop();
+    }
+    t_2 = clock_type::now();
+    const double timer_key_ns = std::chrono::duration<double, std::nano>(t_2 - t_1).count() / iterations;
+
+    Fast_Timer& fast_timer = Fast_Timer::Get();
+    const uint32_t overhead_id = fast_timer.name_id("Fast_Timer overhead");
+    t_1 = clock_type::now();
+    for(unsigned int i=0; i<iterations; i++)
+    {
+        fast_timer.start(overhead_id);
+        fast_timer.stop();
+    }
+    t_2 = clock_type::now();
+    const double fast_timer_ns = std::chrono::duration<double, std::nano>(t_2 - t_1).count() / iterations;
+
+    std::cout << "Timer start/stop : " << timer_ns << " ns | Timer key start/stop : " << timer_key_ns << " ns | Fast_Timer start/stop : "
+        << fast_timer_ns << " ns (" << (Tsc_Clock::uses_tsc() ? "TSC" : "CLOCK_MONOTONIC") << ")" << std::endl;
+
+#if OBJ_DETECT_INSTRUMENTATION == 1
+    // an idle probe is one relaxed load, an enabled one the same Fast_Timer start/stop
+    for(const bool enabled : {false, true})
+    {
+        Probe::enable(enabled);
+        t_1 = clock_type::now();
+        for(unsigned int i=0; i<iterations; i++)
+        {
+            PROBE_SCOPE("Probe overhead");
+        }
+        t_2 = clock_type::now();
+        std::cout << "PROBE_SCOPE " << (enabled ? "enabled" : "disabled") << " : "
+            << std::chrono::duration<double, std::nano>(t_2 - t_1).count() / iterations << " ns" << std::endl;
+    }
+    Probe::enable(false);
+#endif
+
+    const unsigned int mat_size = 224 * 224;
+    const unsigned int num_filters = 21;
+    std::vector<int8_t> tensor(mat_size * num_filters);
+    std::vector<int8_t> mat(mat_size);
+    srand(seed);
+    fill_vec(tensor);
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS);
+    const uint32_t frame_id = fast_timer.name_id("argmax MT frame");
+    const uint32_t chunk_id = fast_timer.name_id("argmax MT chunk");
+    for(unsigned int c=0; c<100; c++)
+    {
+        Fast_Timer::Scope frame_scope(frame_id);
+        thread_pool.parallel_for(0, mat_size, 224, [&](const unsigned int begin, const unsigned int end){
+            Fast_Timer::Scope chunk_scope(chunk_id);
+            argmax_tensor(tensor.data() + num_filters * begin, mat.data() + begin, num_filters, end - begin);
+        }, obj_detect::Partition::dynamic);
+    }
+    fast_timer.print_duration();
+    fast_timer.reset();
+}
+
+void test_fast_timer()
+{
+    Fast_Timer& fast_timer = Fast_Timer::Get();
+    const uint32_t outer_id = fast_timer.name_id("test outer");
+    const uint32_t inner_id = fast_timer.name_id("test inner");
+    for(unsigned int i=0; i<5; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_threads = rand()%8 + 1;
+        const unsigned int num_items = rand()%2000 + 1;
+        const unsigned int num_inner = rand()%4 + 1;
+        fast_timer.reset();
+        {
+            obj_detect::Thread_Pool thread_pool(num_threads, obj_detect::Scheduler(i%3));
+            thread_pool.parallel_for(0, num_items, 1, [&](const unsigned int begin, const unsigned int end){
+                for(unsigned int item=begin; item<end; item++)
+                {
+                    Fast_Timer::Scope outer(outer_id);
+                    for(unsigned int k=0; k<num_inner; k++)
+                    {
+                        Fast_Timer::Scope inner(inner_id);
+                    }
+                }
+            }, obj_detect::Partition::dynamic);
+        }
+
+        // every scope is recorded once, at its own depth, and every inner scope sits inside an outer one of its thread
+        unsigned int num_outer_events = 0;
+        unsigned int num_inner_events = 0;
+        std::vector<Fast_Timer::Event> last_outer;
+        bool valid = true;
+        std::vector<std::vector<Fast_Timer::Event>> inner_events;
+        fast_timer.for_each_event([&](const unsigned int buffer_index, const Fast_Timer::Event& event){
+            if(buffer_index >= inner_events.size()) inner_events.resize(buffer_index + 1);
+            if(event.name_id == outer_id)
+            {
+                num_outer_events++;
+                valid = valid && event.depth == 0 && event.start <= event.stop;
+                for(const auto& inner : inner_events[buffer_index])
+                {
+                    valid = valid && inner.start >= event.start && inner.stop <= event.stop;
+                }
+                valid = valid && inner_events[buffer_index].size() == num_inner;
+                inner_events[buffer_index].clear();
+            }
+            else if(event.name_id == inner_id)
+            {
+                num_inner_events++;
+                valid = valid && event.depth == 1;
+                inner_events[buffer_index].push_back(event);
+            }
+        });
+        if(!valid || num_outer_events != num_items || num_inner_events != num_items * num_inner)
+        {
+            std::cerr<<"fast timer mismatch : "<< num_outer_events<< " outer, " << num_inner_events << " inner for " << num_items <<std::endl;
+        }
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"T : "<< num_threads<<" | ";
+        std::cout<<"Items : "<< num_items<<std::endl;
+    }
+    fast_timer.reset();
+}
+
+void test_latency_histogram()
+{
+    for(unsigned int i=0; i<10; i++)
+    {
+        srand(time(NULL)+i*10);
+        const unsigned int num_values = rand()%20000 + 1;
+        // a log-uniform spread from ns to seconds, the shape of real block timings with their stalls
+        std::vector<uint64_t> values(num_values);
+        for(auto& value : values) value = (uint64_t)std::exp((rand()%30000) / 1000.0);
+
+        Latency_Histogram histogram;
+        Latency_Histogram first_half;
+        Latency_Histogram second_half;
+        for(unsigned int v=0; v<num_values; v++)
+        {
+            histogram.record(values[v]);
+            (v < num_values / 2 ? first_half : second_half).record(values[v]);
+        }
+
+        // percentiles stay within one bucket (1/32) of the exact order statistic
+        std::vector<uint64_t> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        bool valid = histogram.min() == sorted.front() && histogram.max() == sorted.back() && histogram.count() == num_values;
+        for(const double percentile : {1.0, 50.0, 90.0, 99.0, 99.9})
+        {
+            const uint64_t rank = (uint64_t)std::ceil(percentile / 100.0 * num_values);
+            const double exact = (double)sorted[(rank > 0 ? rank : 1) - 1];
+            valid = valid && std::abs((double)histogram.percentile(percentile) - exact) <= exact / 32.0 + 1.0;
+        }
+        double sum = 0.0;
+        for(const auto value : values) sum += (double)value;
+        double squares = 0.0;
+        for(const auto value : values) squares += ((double)value - sum / num_values) * ((double)value - sum / num_values);
+        const double stddev = std::sqrt(squares / num_values);
+        valid = valid && std::abs(histogram.stddev() - stddev) <= 1e-6 * stddev + 1e-3;
+
+        // halves merged back together, and a saved then reloaded histogram, report the same as the whole
+        first_half.merge(second_half);
+        std::stringstream stream;
+        histogram.save(stream);
+        Latency_Histogram loaded;
+        valid = valid && loaded.load(stream);
+        for(const double percentile : {0.0, 50.0, 90.0, 99.0, 99.9, 100.0})
+        {
+            valid = valid && first_half.percentile(percentile) == histogram.percentile(percentile);
+            valid = valid && loaded.percentile(percentile) == histogram.percentile(percentile);
+        }
+        valid = valid && first_half.count() == histogram.count() && loaded.count() == histogram.count();
+        if(!valid) std::cerr<<"latency histogram mismatch"<<std::endl;
+
+        std::cout<<"I : "<< i<<" | ";
+        std::cout<<"Values : "<< num_values<<" | ";
+        std::cout<<"P99 : "<< histogram.percentile(99)<<" ns"<<std::endl;
+    }
+}
+
+// Timer keys survive reset(), and the kernel probes record every call without a heap allocation once the event
+// buffers are reserved. in a no instrumentation build PROBE_SCOPE is an empty statement
+void test_probe()
+{
+    const Timer_Key timer_key = Timer::Get().key("test probe key");
+    if(Timer::Get().key("test probe key") != timer_key) std::cerr<<"timer key mismatch"<<std::endl;
+    Timer::Get().start(timer_key);
+    Timer::Get().stop();
+    const unsigned long timer_allocations = g_num_allocations;
+    for(unsigned int i=0; i<100; i++)
+    {
+        Timer::Get().start(timer_key);
+        Timer::Get().stop();
+    }
+    if(g_num_allocations != timer_allocations) std::cerr<<"timer key allocation mismatch : "<< g_num_allocations - timer_allocations << " != 0\n";
+    if(Timer::Get().get_histogram("test probe key").count() != 101) std::cerr<<"timer key count mismatch"<<std::endl;
+    Timer::Get().reset();
+    Timer::Get().start(timer_key);
+    Timer::Get().stop();
+    if(Timer::Get().get_histogram("test probe key").count() != 1) std::cerr<<"timer key reset mismatch"<<std::endl;
+    Timer::Get().reset();
+
+#if OBJ_DETECT_INSTRUMENTATION == 1
+    const unsigned int num_rows = 28;
+    const unsigned int num_columns = 28;
+    const unsigned int num_filters = 21;
+    const unsigned int scale_up_factor = 8;
+    const unsigned int mat_size = num_rows * num_columns;
+
+    obj_detect::Thread_Pool thread_pool(NUM_THREADS, obj_detect::Scheduler::lock_free_queue, obj_detect::Idle_Policy::spin_then_park);
+    std::vector<int8_t> tensor(mat_size * num_filters);
+    std::vector<int8_t> mat(mat_size);
+    std::vector<int8_t> scaled_up_mat(mat_size * scale_up_factor * scale_up_factor);
+    fill_vec(tensor);
+
+    auto frame = [&](){
+        argmax_tensor_mt(tensor.data(), mat.data(), num_filters, mat_size, thread_pool);
+        argmax_up_scale_mt(tensor.data(), scaled_up_mat.data(), num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+    };
+
+    Fast_Timer& fast_timer = Fast_Timer::Get();
+    fast_timer.reset();
+    frame();
+    if(!fast_timer.collect().empty()) std::cerr<<"disabled probe recorded"<<std::endl;
+
+    const unsigned int num_frames = 100;
+    fast_timer.reserve(4 * num_frames);
+    Probe::enable(true);
+    frame();
+    fast_timer.reset();
+    const unsigned long num_allocations = g_num_allocations;
+    for(unsigned int c=0; c<num_frames; c++) frame();
+    const unsigned long probe_allocations = g_num_allocations - num_allocations;
+    Probe::enable(false);
+
+    std::cout<<"Probe heap allocations per frame : "<< (double)probe_allocations / num_frames <<std::endl;
+    if(probe_allocations != 0) std::cerr<<"probe allocation mismatch : "<< probe_allocations << " != 0\n";
+    unsigned int num_matched = 0;
+    for(const auto& stats : fast_timer.collect())
+    {
+        if(stats.name != "argmax_tensor_mt" && stats.name != "argmax_up_scale_batch_mt") continue;
+        num_matched++;
+        if(stats.count != num_frames) std::cerr<<"probe count mismatch : "<< stats.name << " " << stats.count << " != " << num_frames << "\n";
+    }
+    if(num_matched != 2) std::cerr<<"probe names mismatch"<<std::endl;
+    fast_timer.reset();
+#else
+    PROBE_SCOPE("compiled out");
+    std::cout<<"Probes compiled out"<<std::endl;
+#endif
+}
+
+// the exported trace has one complete event per recorded scope, a named track per recording thread and escaped names,
+// the csv one line per block
+void test_trace_export()
+{
+    Fast_Timer& fast_timer = Fast_Timer::Get();
+    fast_timer.reset();
+    fast_timer.set_thread_name("main");
+    const uint32_t item_id = fast_timer.name_id("trace item");
+    const uint32_t quoted_id = fast_timer.name_id("quoted \"name\", with comma");
+    // one task per worker, each holds until every task has started, so every worker records on its own track
+    // and the caller, which only waits, records none of them
+    const unsigned int num_workers = 4;
+    {
+        obj_detect::Thread_Pool thread_pool(num_workers);
+        std::atomic_uint started(0);
+        std::atomic_uint done(0);
+        for(unsigned int w=0; w<num_workers; w++)
+        {
+            thread_pool.assign([&](){
+                started++;
+                while(started < num_workers) std::this_thread::yield();
+                for(unsigned int i=0; i<200 / num_workers; i++)
+                {
+                    Fast_Timer::Scope scope(item_id);
+                }
+                done++;
+            });
+        }
+        while(done < num_workers) std::this_thread::yield();
+    }
+    {
+        Fast_Timer::Scope scope(quoted_id);
+    }
+    Timer::Get().record_events(true);
+    const Timer_Key timer_key = Timer::Get().key("trace timer block");
+    for(unsigned int i=0; i<3; i++)
+    {
+        Timer::Get().start(timer_key);
+        Timer::Get().stop();
+    }
+    Timer::Get().record_events(false);
+    Timer::Get().start(timer_key);
+    Timer::Get().stop();
+    Timer::Get().reset();
+
+    unsigned int num_events = 0;
+    std::vector<unsigned int> buffers;
+    fast_timer.for_each_event([&](const unsigned int buffer_index, const Fast_Timer::Event&){
+        num_events++;
+        if(std::find(buffers.begin(), buffers.end(), buffer_index) == buffers.end()) buffers.push_back(buffer_index);
+    });
+
+    const std::string trace_path = "test_trace.json";
+    const std::string csv_path = "test_trace.csv";
+    if(!fast_timer.write_chrome_trace(trace_path) || !fast_timer.write_csv(csv_path)) std::cerr<<"trace export failed"<<std::endl;
+    std::ifstream trace_file(trace_path);
+    const std::string trace((std::istreambuf_iterator<char>(trace_file)), std::istreambuf_iterator<char>());
+    auto count = [](const std::string& text, const std::string& pattern){
+        unsigned int found = 0;
+        for(size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) found++;
+        return found;
+    };
+    bool valid = trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0;
+    valid = valid && count(trace, "\"ph\":\"X\"") == num_events && num_events == 204;
+    valid = valid && count(trace, "\"name\":\"thread_name\"") == buffers.size();
+    valid = valid && count(trace, "\"name\":\"trace item\"") == 200 && count(trace, "\"name\":\"trace timer block\"") == 3;
+    valid = valid && count(trace, "\"name\":\"quoted \\\"name\\\", with comma\"") == 1;
+    // pool workers name their tracks only when the probes are built, unnamed tracks show up as "thread <index>"
+    valid = valid && buffers.size() == num_workers + 1 && count(trace, "{\"name\":\"main\"}") == 1;
+    valid = valid && count(trace, "{\"name\":\"thread ") == (OBJ_DETECT_INSTRUMENTATION == 0 ? num_workers : 0);
+    for(unsigned int w=0; w<num_workers; w++)
+    {
+        valid = valid && count(trace, "{\"name\":\"worker " + std::to_string(w) + "\"}") == (OBJ_DETECT_INSTRUMENTATION == 0 ? 0 : 1);
+    }
+    if(!valid) std::cerr<<"trace export mismatch"<<std::endl;
+
+    std::ifstream csv_file(csv_path);
+    std::vector<std::string> lines;
+    for(std::string line; std::getline(csv_file, line);) lines.push_back(line);
+    valid = lines.size() == 4 && lines[0].find("name,count,") == 0;
+    valid = valid && std::find_if(lines.begin(), lines.end(), [](const std::string& line){ return line.find("trace item,200,") == 0; }) != lines.end();
+    valid = valid && std::find_if(lines.begin(), lines.end(), [](const std::string& line){ return line.find("trace timer block,3,") == 0; }) != lines.end();
+    valid = valid && std::find_if(lines.begin(), lines.end(), [](const std::string& line){ return line.find("\"quoted \"\"name\"\", with comma\",1,") == 0; }) != lines.end();
+    if(!valid) std::cerr<<"trace csv mismatch"<<std::endl;
+
+    std::cout<<"Trace events : "<< num_events <<" | Tracks : "<< buffers.size() <<std::endl;
+    trace_file.close();
+    csv_file.close();
+    std::remove(trace_path.c_str());
+    std::remove(csv_path.c_str());
+    fast_timer.reset();
+}
+
+// the counters that open see the work between two reads, the ones a container or hypervisor refuses are skipped
+// and the Timer keeps reporting times without them
+void test_perf_counters()
+{
+    Perf_Counters counters;
+    if(!counters.open())
+    {
+        std::cout<<"Perf counters unavailable : "<< counters.error() <<std::endl;
+        if(Timer::Get().key("Counters probe", true)->with_counters) std::cerr<<"timer counters mismatch"<<std::endl;
+        return;
+    }
+
+    Perf_Counters::Snapshot first;
+    Perf_Counters::Snapshot second;
+    bool valid = counters.read(first);
+    std::vector<int8_t> buffer(64 * 1024 * 1024, 1);
+    unsigned int sum = 0;
+    for(const int8_t item : buffer) sum += item;
+    valid = valid && counters.read(second) && sum == buffer.size();
+    for(unsigned int c=0; c<Perf_Counters::num_counters; c++)
+    {
+        const Perf_Counters::Counter counter = (Perf_Counters::Counter)c;
+        if(!counters.available(counter)) continue;
+        const double value = Perf_Counters::difference(first, second, counter);
+        if(counter == Perf_Counters::cycles || counter == Perf_Counters::instructions || counter == Perf_Counters::page_faults) valid = valid && value > 0;
+        std::cout<< Perf_Counters::name(counter) <<" : "<< value <<" | ";
+    }
+    std::cout<<(counters.error().empty() ? "all counters" : counters.error())<<std::endl;
+    if(!valid) std::cerr<<"perf counters mismatch"<<std::endl;
+}
+
+// the single threaded kernels with the perf counters on, the pool versions are left out since the counters
+// only see the thread that starts the block
+void counter_benchmark(const unsigned int cycles, unsigned const int seed)
+{
+    const unsigned int num_rows = 28;
+    const unsigned int num_columns = 28;
+    const unsigned int num_filters = 21;
+    const unsigned int scale_up_factor = 8;
+    const unsigned int mat_size = num_rows * num_columns;
+    const std::string shape = std::to_string(num_columns) + "x" + std::to_string(num_rows) + "x" + std::to_string(num_filters);
+
+    std::vector<int8_t> tensor(mat_size * num_filters);
+    std::vector<int8_t> mat(mat_size);
+    std::vector<int8_t> new_mat(mat_size * scale_up_factor * scale_up_factor);
+    const Timer_Key argmax_key = Timer::Get().key("Counters argmax-" + shape, true);
+    const Timer_Key fused_key = Timer::Get().key("Counters fused-" + shape, true);
+
+    srand(seed);
+    for(unsigned int c=0; c<cycles; c++)
+    {
+        for(auto& i : tensor)
+        {
+            i = rand()%256 - 128;
+        }
+        Timer::Get().start(argmax_key);
+        argmax_tensor(tensor.data(), mat.data(), num_filters, mat_size);
+        Timer::Get().stop();
+
+        Timer::Get().start(fused_key);
+        for(unsigned int r=0; r<num_rows; r++)
+        {
+            argmax_up_scale_row(tensor.data() + r * num_columns * num_filters, new_mat.data() + r * num_columns * scale_up_factor * scale_up_factor, num_columns, num_filters, scale_up_factor);
+        }
+        Timer::Get().stop();
+    }
+}
@@ -1,24 +1,117 @@
 #include "Thread_Pool.hpp"
+#include "Probe.hpp"
 
-obj_detect::Thread_Pool::Thread_Pool(const unsigned int num_threads = 0) : _task_count(0), _join(false)
+// pool and index of the worker running on this thread, so assign() from inside a task can use its own deque
+static thread_local const obj_detect::Thread_Pool* tls_thread_pool = nullptr;
+static thread_local unsigned int tls_worker_index = 0;
+
+obj_detect::Thread_Pool::Thread_Pool(const unsigned int num_threads, const Idle_Policy idle_policy, const unsigned int spin_count) :
+    Thread_Pool(num_threads, Scheduler::shared_queue, idle_policy, spin_count)
+{
+}
+
+obj_detect::Thread_Pool::Thread_Pool(const unsigned int num_threads, const Scheduler scheduler, const Idle_Policy idle_policy, const unsigned int spin_count, const unsigned int queue_capacity_log2) :
+    _task_count(0), _join(false), _num_queued(0), _idle_policy(idle_policy), _spin_count(spin_count),
+    _num_parked_workers(0), _num_parked_waiters(0), _scheduler(scheduler), _next_inbox(0)
 {
     _num_threads = (num_threads > 0) ? num_threads : std::thread::hardware_concurrency();
+    if (_scheduler == Scheduler::work_stealing)
+    {
+        for (unsigned int i = 0; i < _num_threads; i++) _worker_queues.emplace_back(new Worker_Queues());
+    }
+    if (_scheduler == Scheduler::lock_free_queue)
+    {
+        _ring.reset(new Mpmc_Queue<Task>(queue_capacity_log2));
+    }
     for (unsigned int i = 0; i < _num_threads; i++)
     {
-        _threads.emplace_back(std::thread(Thread_Pool::thread_work, this));
+        _threads.emplace_back(std::thread(Thread_Pool::thread_work, this, i));
+    }
+}
+
+void obj_detect::Thread_Pool::submit(Small_Task work, Task_Group* group)
+{
+    while (!try_submit(work, group))
+    {
+        // the ring is full, make room by running queued work on this thread
+        if (!run_pending_task()) std::this_thread::yield();
     }
 }
 
-void obj_detect::Thread_Pool::assign(std::function<void()> work)
+bool obj_detect::Thread_Pool::try_submit(Small_Task& work, Task_Group* group)
 {
+    if (_scheduler == Scheduler::lock_free_queue)
+    {
+        Task task{std::move(work), group};
+        if (!_ring->try_push(task))
+        {
+            work = std::move(task.work);
+            return false;
+        }
+        _num_queued++;
+        wake_worker();
+        return true;
+    }
+
+    if (_scheduler == Scheduler::work_stealing)
+    {
+        const bool from_worker = tls_thread_pool == this;
+        if (from_worker)
+        {
+            Task* task = new Task{std::move(work), group};
+            if (_worker_queues[tls_worker_index]->deque.push(task))
+            {
+                _num_queued++;
+                wake_worker();
+                return true;
+            }
+            // own deque is full, spill into the inbox
+            work = std::move(task->work);
+            delete task;
+        }
+        Worker_Queues& queues = *_worker_queues[from_worker ? tls_worker_index : _next_inbox++ % _num_threads];
+        std::unique_lock<std::mutex> inbox_lck(queues.inbox_mutex);
+        queues.inbox.push(Task{std::move(work), group});
+        queues.inbox_size++;
+        _num_queued++;
+        inbox_lck.unlock();
+        wake_worker();
+        return true;
+    }
+
     std::unique_lock<std::mutex> queue_lck(_queue_mutex);
-    _work_queue.push(work);
+    _work_queue.push(Task{std::move(work), group});
+    _num_queued++;
+    const bool wake = _num_parked_workers > 0;
     queue_lck.unlock();
+    if (wake) _work_cv.notify_one();
+    return true;
+}
+
+void obj_detect::Thread_Pool::wake_worker()
+{
+    // _num_queued is raised before this check and a parking worker counts itself before checking _num_queued,
+    // so one of the two always sees the other
+    if (_num_parked_workers > 0)
+    {
+        {
+            std::lock_guard<std::mutex> queue_lck(_queue_mutex);
+        }
+        _work_cv.notify_one();
+    }
 }
 
 void obj_detect::Thread_Pool::join()
 {
-    _join = true;
+    {
+        std::lock_guard<std::mutex> queue_lck(_queue_mutex);
+        _join = true;
+    }
+    _work_cv.notify_all();
+    {
+        std::lock_guard<std::mutex> done_lck(_done_mutex);
+    }
+    _done_cv.notify_all();
     for (auto& t : _threads)
     {
         if (t.joinable()) t.join();
@@ -30,42 +123,207 @@ unsigned int obj_detect::Thread_Pool::get_num_threads() const
     return _num_threads;
 }
 
+obj_detect::Idle_Policy obj_detect::Thread_Pool::get_idle_policy() const
+{
+    return _idle_policy;
+}
+
+obj_detect::Scheduler obj_detect::Thread_Pool::get_scheduler() const
+{
+    return _scheduler;
+}
+
+bool obj_detect::Thread_Pool::should_park(const unsigned int idle_rounds) const
+{
+    return _idle_policy == Idle_Policy::park || (_idle_policy == Idle_Policy::spin_then_park && idle_rounds >= _spin_count);
+}
+
 void obj_detect::Thread_Pool::wait_until(const unsigned int task_cout)
 {
     // wait only if task count not completed and join not called
-    while (_task_count < task_cout && !_join) std::this_thread::yield();
+    unsigned int idle_rounds = 0;
+    while (_task_count < task_cout && !_join)
+    {
+        if (!should_park(idle_rounds))
+        {
+            std::this_thread::yield();
+            idle_rounds++;
+            continue;
+        }
+        std::unique_lock<std::mutex> done_lck(_done_mutex);
+        _num_parked_waiters++;
+        _done_cv.wait(done_lck, [this, task_cout]() { return _task_count >= task_cout || _join; });
+        _num_parked_waiters--;
+    }
     _task_count = 0;
 }
 
+bool obj_detect::Thread_Pool::run_pending_task()
+{
+    if (_num_queued == 0) return false;
+    const unsigned int worker_index = (tls_thread_pool == this) ? tls_worker_index : _num_threads;
+    uint32_t steal_seed = 2654435761u * (_next_inbox + 1);
+    Task task;
+    if (!take_work(worker_index, steal_seed, task)) return false;
+    run_task(task);
+    return true;
+}
+
+void obj_detect::Thread_Pool::run_task(Task& task)
+{
+    task.work();
+    // captures are released before completion is signalled, and the group may be destroyed
+    // as soon as its count drops, so it is not touched after the decrement
+    task.work.reset();
+    if (task.group != nullptr) task.group->_pending--;
+    else _task_count++;
+    if (_num_parked_waiters > 0)
+    {
+        std::lock_guard<std::mutex> done_lck(_done_mutex);
+        _done_cv.notify_all();
+    }
+}
+
+void obj_detect::Thread_Pool::wait(Task_Group& group)
+{
+    unsigned int idle_rounds = 0;
+    while (group._pending > 0)
+    {
+        if (run_pending_task())
+        {
+            idle_rounds = 0;
+            continue;
+        }
+        if (!should_park(idle_rounds))
+        {
+            std::this_thread::yield();
+            idle_rounds++;
+            continue;
+        }
+        std::unique_lock<std::mutex> done_lck(_done_mutex);
+        _num_parked_waiters++;
+        _done_cv.wait(done_lck, [this, &group]() { return group._pending == 0 || _num_queued > 0 || _join; });
+        _num_parked_waiters--;
+        idle_rounds = 0;
+    }
+}
+
 obj_detect::Thread_Pool::~Thread_Pool()
 {
     join();
 }
 
-void obj_detect::Thread_Pool::thread_work(Thread_Pool* threadPool)
+bool obj_detect::Thread_Pool::take_from_inbox(Worker_Queues& queues, Task& task)
+{
+    if (queues.inbox_size == 0) return false;
+    std::lock_guard<std::mutex> inbox_lck(queues.inbox_mutex);
+    if (queues.inbox.empty()) return false;
+    task = std::move(queues.inbox.front());
+    queues.inbox.pop();
+    queues.inbox_size--;
+    return true;
+}
+
+bool obj_detect::Thread_Pool::take_work(const unsigned int worker_index, uint32_t& steal_seed, Task& task)
 {
-    std::function<void()> work;
-    bool work_assigned = false;
+    if (_scheduler == Scheduler::lock_free_queue)
+    {
+        if (!_ring->try_pop(task)) return false;
+        _num_queued--;
+        return true;
+    }
+
+    if (_scheduler == Scheduler::shared_queue)
+    {
+        std::lock_guard<std::mutex> queue_lck(_queue_mutex);
+        if (_work_queue.empty()) return false;
+        task = std::move(_work_queue.front());
+        _work_queue.pop();
+        _num_queued--;
+        return true;
+    }
+
+    // own deque (newest first), own inbox, then the other workers starting from a random victim.
+    // callers outside the pool pass worker_index == _num_threads and only steal
+    const bool is_worker = worker_index < _num_threads;
+    Task* stolen = is_worker ? _worker_queues[worker_index]->deque.pop() : nullptr;
+    if (stolen == nullptr && is_worker && take_from_inbox(*_worker_queues[worker_index], task))
+    {
+        _num_queued--;
+        return true;
+    }
+    steal_seed ^= steal_seed << 13;
+    steal_seed ^= steal_seed >> 17;
+    steal_seed ^= steal_seed << 5;
+    for (unsigned int i = 0; i < _num_threads && stolen == nullptr; i++)
+    {
+        const unsigned int victim = (steal_seed + i) % _num_threads;
+        if (victim == worker_index) continue;
+        stolen = _worker_queues[victim]->deque.steal();
+        if (stolen == nullptr && take_from_inbox(*_worker_queues[victim], task))
+        {
+            _num_queued--;
+            return true;
+        }
+    }
+    if (stolen == nullptr) return false;
+    task = std::move(*stolen);
+    delete stolen;
+    _num_queued--;
+    return true;
+}
+
+void obj_detect::Thread_Pool::thread_work(Thread_Pool* threadPool, const unsigned int worker_index)
+{
+    Task task;
+    unsigned int idle_rounds = 0;
+    uint32_t steal_seed = 2654435761u * (worker_index + 1);
     std::unique_lock<std::mutex> queue_lck(threadPool->_queue_mutex, std::defer_lock);
-    while (!(threadPool->_join && threadPool->_work_queue.empty())) //break the loop if only join is called and queue is empty 
+    tls_thread_pool = threadPool;
+    tls_worker_index = worker_index;
+    PROBE_THREAD_NAME("worker " + std::to_string(worker_index));
+    while (!(threadPool->_join && threadPool->_num_queued == 0)) //break the loop if only join is called and queue is empty 
     {
-        if (threadPool->_work_queue.empty()) std::this_thread::yield();
-        else
+        if (threadPool->_num_queued == 0)
         {
-            queue_lck.lock();
-            if (!threadPool->_work_queue.empty())
+            if (!threadPool->should_park(idle_rounds))
             {
-                work = threadPool->_work_queue.front();
-                threadPool->_work_queue.pop();
-                work_assigned = true;
+                std::this_thread::yield();
+                idle_rounds++;
+                continue;
             }
+            // parked workers are counted under the queue lock, so assign() knows when a notify is needed
+            queue_lck.lock();
+            threadPool->_num_parked_workers++;
+            threadPool->_work_cv.wait(queue_lck, [threadPool]() { return threadPool->_num_queued > 0 || threadPool->_join; });
+            threadPool->_num_parked_workers--;
             queue_lck.unlock();
-            if (work_assigned)
-            {
-                work();
-                threadPool->_task_count++;
-                work_assigned = false;
-            }
+            idle_rounds = 0;
+        }
+        else if (threadPool->take_work(worker_index, steal_seed, task))
+        {
+            threadPool->run_task(task);
+            idle_rounds = 0;
+        }
+        else
+        {
+            // another worker won the race for the queued task
+            std::this_thread::yield();
         }
     }
+    tls_thread_pool = nullptr;
+}
+
+obj_detect::Task_Group::Task_Group(Thread_Pool& thread_pool) : _thread_pool(thread_pool), _pending(0)
+{
+}
+
+void obj_detect::Task_Group::wait()
+{
+    _thread_pool.wait(*this);
+}
+
+obj_detect::Task_Group::~Task_Group()
+{
+    wait();
 }
\ No newline at end of file
@@ -4,32 +4,220 @@
 #include <functional>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
+#include <memory>
+
+#include "Work_Stealing_Deque.hpp"
+#include "Mpmc_Queue.hpp"
+#include "Small_Task.hpp"
 
 namespace obj_detect
 {
+    // what a worker (and a caller in wait_until) does while there is nothing to run
+    enum class Idle_Policy
+    {
+        spin,           // yield in a loop, lowest wake-up latency, burns a core per idle worker
+        spin_then_park, // yield for spin_count rounds, then block on a condition variable
+        park            // block on a condition variable straight away
+    };
+
+    // how queued tasks reach the workers
+    enum class Scheduler
+    {
+        shared_queue,   // one mutex protected queue for every worker
+        work_stealing,  // per-worker deques, assign() from a worker pushes to its own deque, idle workers steal
+        lock_free_queue // one bounded lock-free MPMC ring, a full ring pushes back on the caller
+    };
+
+    // how parallel_for splits its range
+    enum class Partition
+    {
+        static_chunks,  // one equal chunk per thread (never smaller than grain), no shared state
+        dynamic,        // grain sized chunks claimed from an atomic counter
+        guided          // claimed like dynamic, chunk size shrinks with the remaining work, floored at grain
+    };
+
+    class Task_Group;
+
     class Thread_Pool
     {
     public:
-        Thread_Pool(const unsigned int num_threads);
+        Thread_Pool(const unsigned int num_threads, const Idle_Policy idle_policy = Idle_Policy::spin, const unsigned int spin_count = 2000);
+
+        Thread_Pool(const unsigned int num_threads, const Scheduler scheduler, const Idle_Policy idle_policy = Idle_Policy::spin, const unsigned int spin_count = 2000, const unsigned int queue_capacity_log2 = 10);
 
-        void assign(std::function<void()> work);
+        // work is stored inline in a Small_Task, when the lock-free ring is full the caller runs queued tasks until it fits
+        template <typename F>
+        void assign(F&& work)
+        {
+            submit(Small_Task(std::forward<F>(work)), nullptr);
+        }
+
+        // like assign() but returns false instead of waiting when the lock-free ring is full
+        template <typename F>
+        bool try_assign(F&& work)
+        {
+            Small_Task task(std::forward<F>(work));
+            return try_submit(task, nullptr);
+        }
 
         void join();
 
         unsigned int get_num_threads() const;
 
+        Idle_Policy get_idle_policy() const;
+
+        Scheduler get_scheduler() const;
+
+        // legacy pool-wide barrier, counts every assign() since the last call, so it cannot be shared between callers
         void wait_until(const unsigned int task_cout);
 
+        // runs body(chunk_begin, chunk_end) over [begin, end) on the pool and returns when every chunk is done
+        template <typename Body>
+        void parallel_for(const unsigned int begin, const unsigned int end, const unsigned int grain, const Body& body, const Partition partition = Partition::static_chunks);
+
+        // runs one queued task on the calling thread, false if there was none
+        bool run_pending_task();
+
         ~Thread_Pool();
     private:
-        static void thread_work(Thread_Pool* threadPool);
+        friend class Task_Group;
+
+        struct Task
+        {
+            Small_Task work;
+            Task_Group* group;
+        };
+
+        // work stealing queues of one worker, the inbox takes assign() calls made from outside the pool
+        struct Worker_Queues
+        {
+            Work_Stealing_Deque<Task> deque;
+            std::mutex inbox_mutex;
+            std::queue<Task> inbox;
+            std::atomic_uint inbox_size{0};
+        };
+
+        static void thread_work(Thread_Pool* threadPool, const unsigned int worker_index);
+
+        bool should_park(const unsigned int idle_rounds) const;
+
+        void submit(Small_Task work, Task_Group* group);
+
+        bool try_submit(Small_Task& work, Task_Group* group);
+
+        bool take_work(const unsigned int worker_index, uint32_t& steal_seed, Task& task);
+
+        bool take_from_inbox(Worker_Queues& queues, Task& task);
+
+        void run_task(Task& task);
+
+        void wait(Task_Group& group);
+
+        void wake_worker();
 
         std::atomic_bool _join;
         std::mutex _queue_mutex;
-        std::queue<std::function<void()>> _work_queue;
+        std::queue<Task> _work_queue;
+        std::atomic_uint _num_queued; // tasks waiting in any queue, lets idle workers poll without taking a lock
         unsigned int _num_threads;
         std::vector<std::thread> _threads;
-        std::atomic_uint16_t _task_count;
+        std::atomic_uint _task_count;
+
+        Idle_Policy _idle_policy;
+        unsigned int _spin_count;
+        std::condition_variable _work_cv;
+        std::atomic_uint _num_parked_workers;
+        std::mutex _done_mutex;
+        std::condition_variable _done_cv;
+        std::atomic_uint _num_parked_waiters;
+
+        Scheduler _scheduler;
+        std::vector<std::unique_ptr<Worker_Queues>> _worker_queues;
+        std::atomic_uint _next_inbox;
+
+        std::unique_ptr<Mpmc_Queue<Task>> _ring;
+    };
+
+    // completion handle for one batch of tasks, wait() only waits for the tasks run() through this group
+    // and helps with queued work meanwhile, so any number of callers can share one pool
+    class Task_Group
+    {
+    public:
+        Task_Group(Thread_Pool& thread_pool);
+
+        Task_Group(const Task_Group&) = delete;
+
+        template <typename F>
+        void run(F&& work)
+        {
+            _pending++;
+            _thread_pool.submit(Small_Task(std::forward<F>(work)), this);
+        }
+
+        void wait();
+
+        ~Task_Group();
+    private:
+        friend class Thread_Pool;
+
+        Thread_Pool& _thread_pool;
+        std::atomic<uint64_t> _pending;
     };
+
+    template <typename Body>
+    void Thread_Pool::parallel_for(const unsigned int begin, const unsigned int end, const unsigned int grain, const Body& body, const Partition partition)
+    {
+        if (begin >= end) return;
+        const unsigned int total_work_count = end - begin;
+        const unsigned int min_chunk = grain > 0 ? grain : 1;
+        const unsigned int max_chunks = (total_work_count + min_chunk - 1) / min_chunk;
+        const unsigned int num_chunks = max_chunks < _num_threads ? max_chunks : _num_threads;
+        Task_Group task_group(*this);
+
+        if (partition == Partition::static_chunks)
+        {
+            const unsigned int work_per_chunk = total_work_count / num_chunks;
+            const unsigned int work_left = total_work_count % num_chunks;
+            unsigned int chunk_begin = begin;
+            for (unsigned int i = 0; i < num_chunks; i++)
+            {
+                const unsigned int work_count = (i < work_left ? work_per_chunk + 1 : work_per_chunk);
+                task_group.run([&body, chunk_begin, work_count]() { body(chunk_begin, chunk_begin + work_count); });
+                chunk_begin += work_count;
+            }
+            task_group.wait();
+            return;
+        }
+
+        std::atomic_uint next(begin);
+        const unsigned int num_threads = _num_threads;
+        for (unsigned int i = 0; i < num_chunks; i++)
+        {
+            task_group.run([&body, &next, end, min_chunk, partition, num_threads]() {
+                while (true)
+                {
+                    unsigned int chunk_begin = next.load();
+                    unsigned int chunk_size = min_chunk;
+                    if (partition == Partition::dynamic)
+                    {
+                        chunk_begin = next.fetch_add(chunk_size);
+                    }
+                    else
+                    {
+                        do
+                        {
+                            if (chunk_begin >= end) break;
+                            const unsigned int guided_size = (end - chunk_begin) / (2 * num_threads);
+                            chunk_size = guided_size > min_chunk ? guided_size : min_chunk;
+                        } while (!next.compare_exchange_weak(chunk_begin, chunk_begin + chunk_size));
+                    }
+                    if (chunk_begin >= end) break;
+                    body(chunk_begin, (end - chunk_begin < chunk_size) ? end : chunk_begin + chunk_size);
+                }
+            });
+        }
+        task_group.wait();
+    }
 }
\ No newline at end of file
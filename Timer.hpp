@@ -4,6 +4,11 @@
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <thread>
+
+#include "Latency_Histogram.hpp"
+#include "Fast_Timer.hpp"
+#include "Perf_Counters.hpp"
 
 #if __linux__ == 1
 struct Time_data
@@ -14,25 +19,44 @@ struct Time_data
     double t_monotonic_raw = 0;
     double t_real = 0;
     unsigned int cycles = 0;
+    Latency_Histogram histogram; // MONOTONIC durations in ns
+    uint32_t event_id = 0;       // Fast_Timer name of the block when events are recorded
+    bool with_counters = false;      // the block is registered for perf counters
+    double counters[Perf_Counters::num_counters] = {};
+    unsigned int counter_cycles = 0; // cycles timed with the counters on
 };
 #else
 struct Time_data
 {
     double time = 0.0;
     unsigned int cycles = 0;
+    Latency_Histogram histogram; // durations in ns
+    uint32_t event_id = 0;       // Fast_Timer name of the block when events are recorded
 };
 #endif
+// a registered block, map nodes never move so the handle stays valid for the life of the timer
+typedef Time_data* Timer_Key;
+
 class Base_Timer
 {
 public:
     Base_Timer() {}
-    virtual void start(std::string map_name) = 0;
+    virtual void start(const std::string& map_name) = 0;
     virtual void stop() = 0;
     virtual void reset() = 0;
     virtual void print_duration() = 0;
     virtual ~Base_Timer() {}
+
+    // every start/stop pair also becomes a Fast_Timer scope on the calling thread, so Timer blocks
+    // land in the exported trace next to the probes and the pool workers
+    void record_events(const bool enabled)
+    {
+        m_record_events = enabled;
+    }
 protected:
-    std::string m_map_name;
+    Timer_Key m_current = nullptr;
+    bool m_record_events = false;
+    bool m_event_open = false;
     std::map<std::string, Time_data> m_time_data;
 };
 #if __linux__ == 1
@@ -48,19 +72,31 @@ public:
         return instance;
     }
 
-    void start(std::string map_name) override
+    using Base_Timer::record_events;
+
+    // registers the block once, outside the timed loop, start(key) then does no lookup and no string copy.
+    // with_counters also reads the perf counters around the block, they count the thread that registers the first
+    // such block only, so a block started elsewhere or handing its work to a Thread_Pool is timed without them
+    Timer_Key key(const std::string& map_name, const bool with_counters = false)
+    {
+        const auto it = m_time_data.find(map_name);
+        Time_data& data = it != m_time_data.end() ? it->second : m_time_data[map_name];
+        if (it == m_time_data.end()) data.event_id = Fast_Timer::Get().name_id(map_name);
+        if (with_counters && open_counters()) data.with_counters = true;
+        return &data;
+    }
+
+    void start(const std::string& map_name) override
     {
-        m_map_name = map_name;
-        if (m_time_data.find(m_map_name) == m_time_data.end())
-        {
-            m_time_data[m_map_name].t_cpu_time_used = 0.0;
-            m_time_data[m_map_name].t_process_cpu = 0.0;
-            m_time_data[m_map_name].t_monotonic = 0.0;
-            m_time_data[m_map_name].t_monotonic_raw = 0.0;
-            m_time_data[m_map_name].t_real = 0.0;
-            m_time_data[m_map_name].cycles = 0;
-        }
+        start(key(map_name));
+    }
 
+    void start(const Timer_Key key)
+    {
+        m_current = key;
+        m_event_open = m_record_events;
+        if (m_event_open) Fast_Timer::Get().start(key->event_id);
+        m_counting = key->with_counters && std::this_thread::get_id() == m_counters_thread && m_counters.read(m_counters_1);
         clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t_process_cpu_1);
         clock_gettime(CLOCK_MONOTONIC, &t_monotonic_1);
         clock_gettime(CLOCK_MONOTONIC_RAW, &t_monotonic_raw_1);
@@ -75,40 +111,66 @@ public:
         clock_gettime(CLOCK_MONOTONIC_RAW, &t_monotonic_raw_2);
         clock_gettime(CLOCK_REALTIME, &t_real_2);
         t2 = clock();
+        Perf_Counters::Snapshot counters_2;
+        const bool counted = m_counting && m_counters.read(counters_2);
+        m_counting = false;
+        if (m_event_open) Fast_Timer::Get().stop();
+        m_event_open = false;
+        if (m_current == nullptr) return;
+        Time_data& data = *m_current;
+
+        if (counted)
+        {
+            for (unsigned int c = 0; c < Perf_Counters::num_counters; c++)
+            {
+                data.counters[c] += Perf_Counters::difference(m_counters_1, counters_2, (Perf_Counters::Counter)c);
+            }
+            data.counter_cycles += 1;
+        }
 
-        m_time_data.at(m_map_name).t_cpu_time_used += 1000.0 * (t2 - t1) / CLOCKS_PER_SEC;
+        data.t_cpu_time_used += 1000.0 * (t2 - t1) / CLOCKS_PER_SEC;
 
-        m_time_data.at(m_map_name).t_process_cpu += (1000.0 * t_process_cpu_2.tv_sec + 1e-6 * t_process_cpu_2.tv_nsec) -
+        data.t_process_cpu += (1000.0 * t_process_cpu_2.tv_sec + 1e-6 * t_process_cpu_2.tv_nsec) -
             (1000.0 * t_process_cpu_1.tv_sec + 1e-6 * t_process_cpu_1.tv_nsec);
-        m_time_data.at(m_map_name).t_monotonic += (1000.0 * t_monotonic_2.tv_sec + 1e-6 * t_monotonic_2.tv_nsec) -
+        data.t_monotonic += (1000.0 * t_monotonic_2.tv_sec + 1e-6 * t_monotonic_2.tv_nsec) -
             (1000.0 * t_monotonic_1.tv_sec + 1e-6 * t_monotonic_1.tv_nsec);
-        m_time_data.at(m_map_name).t_monotonic_raw += (1000.0 * t_monotonic_raw_2.tv_sec + 1e-6 * t_monotonic_raw_2.tv_nsec) -
+        data.histogram.record(
+            (uint64_t)(t_monotonic_2.tv_sec - t_monotonic_1.tv_sec) * 1000000000ull + t_monotonic_2.tv_nsec - t_monotonic_1.tv_nsec);
+        data.t_monotonic_raw += (1000.0 * t_monotonic_raw_2.tv_sec + 1e-6 * t_monotonic_raw_2.tv_nsec) -
             (1000.0 * t_monotonic_raw_1.tv_sec + 1e-6 * t_monotonic_raw_1.tv_nsec);
-        m_time_data.at(m_map_name).t_real += (1000.0 * t_real_2.tv_sec + 1e-6 * t_real_2.tv_nsec) -
+        data.t_real += (1000.0 * t_real_2.tv_sec + 1e-6 * t_real_2.tv_nsec) -
             (1000.0 * t_real_1.tv_sec + 1e-6 * t_real_1.tv_nsec);
-        m_time_data.at(m_map_name).cycles += 1;
+        data.cycles += 1;
     }
+    // zeroes the blocks instead of erasing them, so the keys handed out stay valid
     void reset() override
     {
-        m_time_data.clear();
+        for (auto& item : m_time_data)
+        {
+            const uint32_t event_id = item.second.event_id;
+            item.second = Time_data();
+            item.second.event_id = event_id;
+        }
     }
     void print_duration() override
     {
 
         std::cout << "Time in ms" << std::endl;
         std::cout
-            << std::left << std::setw(25) << "Bolck name"
+            << std::left << std::setw(30) << "Bolck name"
             << std::left << std::setw(20) << "CPU TIME USED"
             << std::left << std::setw(20) << "PROCESS_CPUTIME_ID"
             << std::left << std::setw(20) << "MONOTONIC"
             << std::left << std::setw(20) << "MONOTONIC_RAW"
             << std::left << std::setw(20) << "REALTIME"
             << std::left << std::setw(20) << "Cycles"
+            << Latency_Histogram::report_header()
             << std::endl << std::endl;
 
         for (auto it = m_time_data.begin(); it != m_time_data.end(); it++) {
             std::string name = it->first;
             const unsigned int cycles = m_time_data.at(name).cycles;
+            if (cycles == 0) continue;
             const double t_cpu_time_used = m_time_data.at(name).t_cpu_time_used;
             const double t_monotonic = m_time_data.at(name).t_monotonic;
             const double t_monotonic_raw = m_time_data.at(name).t_monotonic_raw;
@@ -116,22 +178,87 @@ public:
             const double t_real = m_time_data.at(name).t_real;
 
             std::cout
-                << std::left << std::setw(25) << name
+                << std::left << std::setw(30) << name
                 << std::left << std::setw(20) << t_cpu_time_used / cycles
                 << std::left << std::setw(20) << t_process_cpu / cycles
                 << std::left << std::setw(20) << t_monotonic / cycles
                 << std::left << std::setw(20) << t_monotonic_raw / cycles
                 << std::left << std::setw(20) << t_real / cycles
                 << std::left << std::setw(20) << cycles
+                << m_time_data.at(name).histogram.report_columns()
                 << std::endl;
         }
+        print_counters();
+    }
+    // latency distribution of a block, empty if the block was never timed
+    Latency_Histogram get_histogram(const std::string& map_name) const
+    {
+        const auto it = m_time_data.find(map_name);
+        return it != m_time_data.end() ? it->second.histogram : Latency_Histogram();
     }
     ~Timer() {}
 private:
     Timer() :Base_Timer() {}
+
+    // opened once on the calling thread, false (with the reason on stderr) when no counter can be opened
+    bool open_counters()
+    {
+        if (m_counters.is_open()) return true;
+        if (m_counters_tried) return false;
+        m_counters_tried = true;
+        if (!m_counters.open())
+        {
+            std::cerr << "Timer counters unavailable : " << m_counters.error() << std::endl;
+            return false;
+        }
+        if (!m_counters.error().empty()) std::cerr << "Timer counters partly unavailable : " << m_counters.error() << std::endl;
+        m_counters_thread = std::this_thread::get_id();
+        return true;
+    }
+
+    // per cycle averages of the blocks timed with the counters on, IPC when both cycles and instructions are counted
+    void print_counters() const
+    {
+        bool any = false;
+        for (const auto& item : m_time_data) any = any || item.second.counter_cycles > 0;
+        if (!any) return;
+
+        std::cout << std::endl << "Counters per cycle (calling thread only, pool workers are not counted)" << std::endl;
+        std::cout << std::left << std::setw(30) << "Bolck name";
+        for (unsigned int c = 0; c < Perf_Counters::num_counters; c++)
+        {
+            if (m_counters.available((Perf_Counters::Counter)c)) std::cout << std::left << std::setw(20) << Perf_Counters::name((Perf_Counters::Counter)c);
+        }
+        const bool ipc = m_counters.available(Perf_Counters::cycles) && m_counters.available(Perf_Counters::instructions);
+        if (ipc) std::cout << std::left << std::setw(20) << "IPC";
+        std::cout << std::endl << std::endl;
+
+        for (const auto& item : m_time_data)
+        {
+            const Time_data& data = item.second;
+            if (data.counter_cycles == 0) continue;
+            std::cout << std::left << std::setw(30) << item.first;
+            for (unsigned int c = 0; c < Perf_Counters::num_counters; c++)
+            {
+                if (m_counters.available((Perf_Counters::Counter)c)) std::cout << std::left << std::setw(20) << data.counters[c] / data.counter_cycles;
+            }
+            if (ipc)
+            {
+                const double cycles = data.counters[Perf_Counters::cycles];
+                std::cout << std::left << std::setw(20) << (cycles > 0 ? data.counters[Perf_Counters::instructions] / cycles : 0.0);
+            }
+            std::cout << std::endl;
+        }
+    }
+
     struct timespec t_process_cpu_1, t_monotonic_1, t_monotonic_raw_1, t_real_1;
     struct timespec t_process_cpu_2, t_monotonic_2, t_monotonic_raw_2, t_real_2;
     clock_t t1, t2;
+    Perf_Counters m_counters;
+    Perf_Counters::Snapshot m_counters_1;
+    std::thread::id m_counters_thread;
+    bool m_counters_tried = false;
+    bool m_counting = false;
 };
 #else
 #include <chrono>
@@ -146,43 +273,75 @@ public:
         return instance;
     }
 
-    void start(std::string map_name) override
+    using Base_Timer::record_events;
+
+    // registers the block once, outside the timed loop, start(key) then does no lookup and no string copy.
+    // perf_event_open counters are linux only, with_counters is ignored
+    Timer_Key key(const std::string& map_name, const bool = false)
+    {
+        const auto it = m_time_data.find(map_name);
+        if (it != m_time_data.end()) return &it->second;
+        Time_data& data = m_time_data[map_name];
+        data.event_id = Fast_Timer::Get().name_id(map_name);
+        return &data;
+    }
+
+    void start(const std::string& map_name) override
     {
-        m_map_name = map_name;
-        if (m_time_data.find(m_map_name) == m_time_data.end())
-        {
-            m_time_data[m_map_name].time = 0.0;
-            m_time_data[m_map_name].cycles = 0;
-        }
+        start(key(map_name));
+    }
+
+    void start(const Timer_Key key)
+    {
+        m_current = key;
+        m_event_open = m_record_events;
+        if (m_event_open) Fast_Timer::Get().start(key->event_id);
         m_StartTimePoint = std::chrono::high_resolution_clock::now();
     }
     void stop() override
     {
         auto entTimePoint = std::chrono::high_resolution_clock::now();
+        if (m_event_open) Fast_Timer::Get().stop();
+        m_event_open = false;
         auto start = std::chrono::time_point_cast<std::chrono::microseconds>(m_StartTimePoint).time_since_epoch().count();
         auto end = std::chrono::time_point_cast<std::chrono::microseconds>(entTimePoint).time_since_epoch().count();
 
         auto duration = (end - start) * 0.001;
-        m_time_data.at(m_map_name).time += duration;
-        m_time_data.at(m_map_name).cycles += 1;
+        if (m_current == nullptr) return;
+        m_current->time += duration;
+        m_current->histogram.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(entTimePoint - m_StartTimePoint).count());
+        m_current->cycles += 1;
     }
+    // zeroes the blocks instead of erasing them, so the keys handed out stay valid
     void reset() override
     {
-        m_time_data.clear();
+        for (auto& item : m_time_data)
+        {
+            const uint32_t event_id = item.second.event_id;
+            item.second = Time_data();
+            item.second.event_id = event_id;
+        }
     }
     void print_duration() override
     {
 
-        std::cout << std::left << std::setw(30) << "Bolck name" << std::left << std::setw(20) << "Time (ms)" << std::left << std::setw(10) << "Cycles" << std::endl;
+        std::cout << std::left << std::setw(30) << "Bolck name" << std::left << std::setw(20) << "Time (ms)" << std::left << std::setw(10) << "Cycles" << Latency_Histogram::report_header() << std::endl;
         std::cout << std::left << std::setw(30) << "----------" << std::left << std::setw(20) << "---------" << std::left << std::setw(10) << "------" << std::endl;
 
         for (auto it = m_time_data.begin(); it != m_time_data.end(); it++) {
             std::string name = it->first;
             const unsigned int cycles = m_time_data.at(name).cycles;
+            if (cycles == 0) continue;
             const double time = m_time_data.at(name).time;
-            std::cout << std::left << std::setw(30) << name << std::left << std::setw(20) << time / cycles << std::left << std::setw(10) << cycles << std::endl;
+            std::cout << std::left << std::setw(30) << name << std::left << std::setw(20) << time / cycles << std::left << std::setw(10) << cycles << m_time_data.at(name).histogram.report_columns() << std::endl;
         }
     }
+    // latency distribution of a block, empty if the block was never timed
+    Latency_Histogram get_histogram(const std::string& map_name) const
+    {
+        const auto it = m_time_data.find(map_name);
+        return it != m_time_data.end() ? it->second.histogram : Latency_Histogram();
+    }
     ~Timer() {}
 private:
     Timer() :Base_Timer() {}
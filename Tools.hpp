@@ -1,7 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstring>
+#include <iostream>
+#include <vector>
 #include "Thread_Pool.hpp"
+#include "Argmax_Simd.hpp"
+#include "Packed_Mask.hpp"
+#include "Probe.hpp"
 
 template<typename T>
 inline unsigned int argmax(const T* const arr_ptr, unsigned const int size)
@@ -14,42 +22,125 @@ inline unsigned int argmax(const T* const arr_ptr, unsigned const int size)
     return (unsigned int)(max_val_ptr - arr_ptr);
 }
 
-template <typename T>
-inline void argmax_tensor(const T* tensor_ptr, T* const mat_ptr, const unsigned int num_filters, const unsigned int mat_size)
+// the class index type I is independent of the logit type T, it only has to hold num_filters - 1
+template <typename T, typename I>
+inline void argmax_tensor(const T* tensor_ptr, I* const mat_ptr, const unsigned int num_filters, const unsigned int mat_size)
+{
+    for(unsigned int i=0; i<mat_size; i++)
+    {
+        mat_ptr[i] = (I)argmax(tensor_ptr, num_filters);
+        tensor_ptr += num_filters;
+    }
+}
+
+// argmax that also returns the winning value and the best value among the other classes, in one pass.
+// the first index wins on ties and the runner-up of a tie is the tied value, a single class is its own runner-up
+template<typename T>
+inline unsigned int argmax_top2(const T* const arr_ptr, unsigned const int size, T& max_val, T& runner_up_val)
+{
+    unsigned int max_index = 0;
+    T best = arr_ptr[0];
+    T second = arr_ptr[size > 1 ? 1 : 0];
+    for(unsigned int i = 1; i<size; i++)
+    {
+        const T val = arr_ptr[i];
+        if(val > best)
+        {
+            second = best;
+            best = val;
+            max_index = i;
+        }
+        else if(val > second)
+        {
+            second = val;
+        }
+    }
+    max_val = best;
+    runner_up_val = second;
+    return max_index;
+}
+
+// argmax_tensor plus optional per cell planes, value_ptr gets the winning logit and margin_ptr its margin over the
+// runner-up (0 on a tie). either plane may be null. I holds the class index as in argmax_tensor, M must hold the
+// full margin, uint8_t for int8 logits
+template <typename T, typename I, typename M>
+inline void argmax_top2_tensor(
+    const T* tensor_ptr,
+    I* const mat_ptr,
+    T* const value_ptr,
+    M* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
 {
     for(unsigned int i=0; i<mat_size; i++)
     {
-        mat_ptr[i] = (T)argmax(tensor_ptr, num_filters);
+        T max_val;
+        T runner_up_val;
+        mat_ptr[i] = (I)argmax_top2(tensor_ptr, num_filters, max_val, runner_up_val);
+        if(value_ptr) value_ptr[i] = max_val;
+        if(margin_ptr) margin_ptr[i] = (M)(max_val - runner_up_val);
         tensor_ptr += num_filters;
     }
 }
 
+// planar (one mat_size plane per filter) argmax, a running max across planes over blocks of pixels.
+// I holds the class index as in argmax_tensor
+template <typename T, typename I>
+inline void argmax_planar(const T* const tensor_ptr, I* const mat_ptr, const unsigned int num_filters, const unsigned int mat_size)
+{
+    const unsigned int block_size = 256;
+    T max_vals[block_size];
+    for(unsigned int start=0; start<mat_size; start+=block_size)
+    {
+        const unsigned int count = (mat_size - start < block_size) ? mat_size - start : block_size;
+        I* const mat_cptr = mat_ptr + start;
+        memcpy(max_vals, tensor_ptr + start, sizeof(T) * count);
+        for(unsigned int i=0; i<count; i++) mat_cptr[i] = (I)0;
+        for(unsigned int f=1; f<num_filters; f++)
+        {
+            const T* const plane_cptr = tensor_ptr + (size_t)f * mat_size + start;
+            for(unsigned int i=0; i<count; i++)
+            {
+                const bool greater = plane_cptr[i] > max_vals[i];
+                max_vals[i] = greater ? plane_cptr[i] : max_vals[i];
+                mat_cptr[i] = greater ? (I)f : mat_cptr[i];
+            }
+        }
+    }
+}
+
+// planar to channel-last copy, so planar data can be fed to argmax_tensor
 template <typename T>
+inline void planar_to_channel_last(const T* const planar_ptr, T* const tensor_ptr, const unsigned int num_filters, const unsigned int mat_size)
+{
+    for(unsigned int f=0; f<num_filters; f++)
+    {
+        const T* const plane_cptr = planar_ptr + (size_t)f * mat_size;
+        for(unsigned int i=0; i<mat_size; i++)
+        {
+            tensor_ptr[(size_t)i * num_filters + f] = plane_cptr[i];
+        }
+    }
+}
+
+template <typename T, typename I>
 void argmax_tensor_mt(
     const T* tensor_ptr, 
-    T* const mat_ptr, 
+    I* const mat_ptr, 
     const unsigned int num_filters, 
     const unsigned int mat_size, 
-    obj_detect::Thread_Pool& thread_pool)
+    obj_detect::Thread_Pool& thread_pool,
+    const obj_detect::Partition partition = obj_detect::Partition::static_chunks,
+    const unsigned int grain = 1)
 {
-    const unsigned int num_threads = thread_pool.get_num_threads();
-    const unsigned int work_per_thread = mat_size/num_threads;
-    const unsigned int work_left = mat_size%num_threads;
-    unsigned int total_work_count = 0;
-    unsigned int work_count = 0;
-    for(unsigned int i=0; i<num_threads; i++)
-    {
-        work_count = (i < work_left ? work_per_thread + 1 : work_per_thread);
-        thread_pool.assign([&, total_work_count, work_count](){
-            argmax_tensor(
-                tensor_ptr + num_filters*total_work_count, 
-                mat_ptr + total_work_count, 
-                num_filters, 
-                work_count);
-        });
-        total_work_count += work_count;
-    }
-    thread_pool.wait_until(num_threads);
+    PROBE_SCOPE("argmax_tensor_mt");
+    thread_pool.parallel_for(0, mat_size, grain, [=](const unsigned int begin, const unsigned int end){
+        argmax_tensor(
+            tensor_ptr + num_filters*begin, 
+            mat_ptr + begin, 
+            num_filters, 
+            end - begin);
+    }, partition);
 }
 
 template<typename T>
@@ -86,3 +177,934 @@ void upsampler(
         }
     }
 }
+
+// row helpers for the fused kernels, int8 rows go through the SIMD kernels
+template <typename T, typename I>
+inline void argmax_row(const T* tensor_ptr, I* const mat_ptr, const unsigned int num_filters, const unsigned int num_columns)
+{
+    argmax_tensor(tensor_ptr, mat_ptr, num_filters, num_columns);
+}
+
+inline void argmax_row(const int8_t* tensor_ptr, int8_t* const mat_ptr, const unsigned int num_filters, const unsigned int num_columns)
+{
+    argmax_tensor_simd(tensor_ptr, mat_ptr, num_filters, num_columns);
+}
+
+// the SIMD kernels store the low byte of the index, which is the whole uint8 index up to 256 classes
+inline void argmax_row(const int8_t* tensor_ptr, uint8_t* const mat_ptr, const unsigned int num_filters, const unsigned int num_columns)
+{
+    if(num_filters <= 256) argmax_tensor_simd(tensor_ptr, (int8_t*)mat_ptr, num_filters, num_columns);
+    else argmax_tensor(tensor_ptr, mat_ptr, num_filters, num_columns);
+}
+
+template <typename T>
+inline void broadcast_row(const T* const src_ptr, T* const dst_ptr, const unsigned int num_columns, const unsigned int scale_up_factor)
+{
+    T* dst_cptr = dst_ptr;
+    for(unsigned int c=0; c<num_columns; c++)
+    {
+        for(unsigned int i=0; i<scale_up_factor; i++) dst_cptr[i] = src_ptr[c];
+        dst_cptr += scale_up_factor;
+    }
+}
+
+inline void broadcast_row(const int8_t* const src_ptr, int8_t* const dst_ptr, const unsigned int num_columns, const unsigned int scale_up_factor)
+{
+    broadcast_bytes_simd(src_ptr, dst_ptr, num_columns, scale_up_factor);
+}
+
+// margin planes are bytes as well
+inline void broadcast_row(const uint8_t* const src_ptr, uint8_t* const dst_ptr, const unsigned int num_columns, const unsigned int scale_up_factor)
+{
+    broadcast_bytes_simd((const int8_t*)src_ptr, (int8_t*)dst_ptr, num_columns, scale_up_factor);
+}
+
+template <typename T, typename I, typename M>
+inline void argmax_top2_row(
+    const T* tensor_ptr,
+    I* const mat_ptr,
+    T* const value_ptr,
+    M* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns)
+{
+    argmax_top2_tensor(tensor_ptr, mat_ptr, value_ptr, margin_ptr, num_filters, num_columns);
+}
+
+inline void argmax_top2_row(
+    const int8_t* tensor_ptr,
+    int8_t* const mat_ptr,
+    int8_t* const value_ptr,
+    uint8_t* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns)
+{
+    argmax_top2_simd(tensor_ptr, mat_ptr, value_ptr, margin_ptr, num_filters, num_columns);
+}
+
+// like argmax_row, the SIMD kernel stores the whole uint8 index up to 256 classes
+inline void argmax_top2_row(
+    const int8_t* tensor_ptr,
+    uint8_t* const mat_ptr,
+    int8_t* const value_ptr,
+    uint8_t* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns)
+{
+    if(num_filters <= 256) argmax_top2_simd(tensor_ptr, (int8_t*)mat_ptr, value_ptr, margin_ptr, num_filters, num_columns);
+    else argmax_top2_tensor(tensor_ptr, mat_ptr, value_ptr, margin_ptr, num_filters, num_columns);
+}
+
+// argmax of num_frames frames stored back to back. the frames are contiguous, so the batch is one run
+// of num_frames * mat_size cells cut into grain sized blocks, int8 blocks go through the SIMD kernel
+template <typename T, typename I>
+void argmax_tensor_batch_mt(
+    const T* tensor_ptr,
+    I* const mat_ptr,
+    const unsigned int num_frames,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    obj_detect::Thread_Pool& thread_pool,
+    const unsigned int grain = 256)
+{
+    PROBE_SCOPE("argmax_tensor_batch_mt");
+    thread_pool.parallel_for(0, num_frames * mat_size, grain, [=](const unsigned int begin, const unsigned int end){
+        argmax_row(tensor_ptr + (size_t)num_filters * begin, mat_ptr + begin, num_filters, end - begin);
+    }, obj_detect::Partition::dynamic);
+}
+
+// the num_columns values sitting at the start of the last of the scale_up_factor output rows are broadcast
+// into the first one, which is then copied down over the rest, the scratch row included
+template <typename T>
+inline void up_scale_row_block(T* const scaled_up_row_ptr, const unsigned int num_columns, const unsigned int scale_up_factor)
+{
+    const unsigned int scaled_up_num_columns = num_columns * scale_up_factor;
+    broadcast_row(scaled_up_row_ptr + (scale_up_factor - 1) * scaled_up_num_columns, scaled_up_row_ptr, num_columns, scale_up_factor);
+    for(unsigned int i=1; i<scale_up_factor; i++)
+    {
+        memcpy(scaled_up_row_ptr + i * scaled_up_num_columns, scaled_up_row_ptr, sizeof(T) * scaled_up_num_columns);
+    }
+}
+
+// argmax of one source row written straight into its scale_up_factor output rows.
+// the argmaxes land in the last output row first and are broadcast into the first one,
+// which is then copied down over the rest, the scratch row included.
+template <typename T, typename I>
+inline void argmax_up_scale_row(
+    const T* const tensor_row_ptr,
+    I* const scaled_up_row_ptr,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor)
+{
+    const unsigned int scaled_up_num_columns = num_columns * scale_up_factor;
+    if(scale_up_factor < 2)
+    {
+        argmax_row(tensor_row_ptr, scaled_up_row_ptr, num_filters, num_columns);
+        return;
+    }
+    argmax_row(tensor_row_ptr, scaled_up_row_ptr + (scale_up_factor - 1) * scaled_up_num_columns, num_filters, num_columns);
+    up_scale_row_block(scaled_up_row_ptr, num_columns, scale_up_factor);
+}
+
+// fused argmax + nearest-neighbour upsample of num_frames frames stored back to back,
+// (frame, source row) items are claimed dynamically and there is a single barrier for the whole batch
+template <typename T, typename I>
+void argmax_up_scale_batch_mt(
+    const T* const tensor_ptr,
+    I* const scaled_up_mat_ptr,
+    const unsigned int num_frames,
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor,
+    obj_detect::Thread_Pool& thread_pool)
+{
+    PROBE_SCOPE("argmax_up_scale_batch_mt");
+    const unsigned int tensor_row_size = num_columns * num_filters;
+    const unsigned int scaled_up_row_block_size = num_columns * scale_up_factor * scale_up_factor;
+    thread_pool.parallel_for(0, num_frames * num_rows, 1, [=](const unsigned int begin, const unsigned int end){
+        // frames are contiguous, so row r of frame n is row n * num_rows + r of the batch
+        for(unsigned int r=begin; r<end; r++)
+        {
+            argmax_up_scale_row(
+                tensor_ptr + (size_t)r * tensor_row_size,
+                scaled_up_mat_ptr + (size_t)r * scaled_up_row_block_size,
+                num_columns,
+                num_filters,
+                scale_up_factor);
+        }
+    }, obj_detect::Partition::dynamic);
+}
+
+// fused argmax + nearest-neighbour upsample, source rows are claimed dynamically and there is a single barrier
+template <typename T, typename I>
+void argmax_up_scale_mt(
+    const T* const tensor_ptr,
+    I* const scaled_up_mat_ptr,
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor,
+    obj_detect::Thread_Pool& thread_pool)
+{
+    argmax_up_scale_batch_mt(tensor_ptr, scaled_up_mat_ptr, 1, num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+}
+
+// packed class masks (see Packed_Mask.hpp). the classes pass through a small stack block between the argmax or the
+// unpack and the packing, so the byte mask is never materialized. the multi-threaded kernels hand out work items
+// that start on a byte of the packed output, so no two threads ever write the same byte
+
+// argmax of count cells written into pixels [first_pixel, first_pixel + count) of a packed mask
+template <typename T>
+inline void argmax_packed_row(
+    const T* tensor_ptr,
+    uint8_t* const packed_ptr,
+    const size_t first_pixel,
+    const unsigned int count,
+    const unsigned int num_filters,
+    const unsigned int bits)
+{
+    const unsigned int block_size = 256;
+    uint8_t classes[block_size];
+    for(unsigned int start=0; start<count; start+=block_size)
+    {
+        const unsigned int block_count = (count - start < block_size) ? count - start : block_size;
+        argmax_row(tensor_ptr + (size_t)start * num_filters, classes, num_filters, block_count);
+        pack_mask(classes, packed_ptr, first_pixel + start, block_count, bits);
+    }
+}
+
+template <typename T>
+void argmax_tensor_packed_mt(
+    const T* const tensor_ptr,
+    uint8_t* const packed_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    const unsigned int bits,
+    obj_detect::Thread_Pool& thread_pool,
+    const obj_detect::Partition partition = obj_detect::Partition::static_chunks,
+    const unsigned int grain = 8)
+{
+    PROBE_SCOPE("argmax_tensor_packed_mt");
+    // groups of 8 pixels always start on a byte
+    const unsigned int num_groups = (mat_size + 7) / 8;
+    thread_pool.parallel_for(0, num_groups, (grain + 7) / 8, [=](const unsigned int begin, const unsigned int end){
+        const unsigned int first_pixel = begin * 8;
+        const unsigned int last_pixel = end * 8 < mat_size ? end * 8 : mat_size;
+        argmax_packed_row(tensor_ptr + (size_t)num_filters * first_pixel, packed_ptr, first_pixel, last_pixel - first_pixel, num_filters, bits);
+    }, partition);
+}
+
+// number of source rows whose packed output block of pixels_per_row pixels ends on a byte
+inline unsigned int packed_row_grain(const size_t pixels_per_row, const unsigned int bits)
+{
+    unsigned int rows = 1;
+    while((rows * pixels_per_row * bits) % 8 != 0) rows++;
+    return rows;
+}
+
+// writes count classes of one source row, from source column first_column on, scale_up_factor times into the
+// packed output row starting at pixel row_first_pixel
+inline void up_scale_packed_columns(
+    const uint8_t* const classes_ptr,
+    const unsigned int first_column,
+    const unsigned int count,
+    uint8_t* const packed_ptr,
+    const size_t row_first_pixel,
+    const unsigned int scale_up_factor,
+    const unsigned int bits)
+{
+    const unsigned int run_size = 1024;
+    uint8_t run[run_size];
+    for(unsigned int c=0; c<count;)
+    {
+        // as many source columns as fit in one run, a column wider than a run is written in several
+        const unsigned int run_columns = scale_up_factor < run_size ? run_size / scale_up_factor : 1;
+        const unsigned int num_columns = (count - c < run_columns) ? count - c : run_columns;
+        const size_t num_pixels = (size_t)num_columns * scale_up_factor;
+        if(num_columns > 1) broadcast_row(classes_ptr + c, run, num_columns, scale_up_factor);
+        else memset(run, classes_ptr[c], num_pixels < run_size ? num_pixels : run_size);
+        for(size_t offset=0; offset<num_pixels; offset+=run_size)
+        {
+            const size_t run_count = (num_pixels - offset < run_size) ? num_pixels - offset : run_size;
+            pack_mask(run, packed_ptr, row_first_pixel + (size_t)(first_column + c) * scale_up_factor + offset, run_count, bits);
+        }
+        c += num_columns;
+    }
+}
+
+// fused argmax + nearest-neighbour upsample of one source row into its packed output block
+template <typename T>
+inline void argmax_up_scale_packed_row(
+    const T* const tensor_row_ptr,
+    uint8_t* const packed_ptr,
+    const size_t block_first_pixel,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor,
+    const unsigned int bits)
+{
+    const unsigned int block_size = 256;
+    uint8_t classes[block_size];
+    for(unsigned int start=0; start<num_columns; start+=block_size)
+    {
+        const unsigned int count = (num_columns - start < block_size) ? num_columns - start : block_size;
+        argmax_row(tensor_row_ptr + (size_t)start * num_filters, classes, num_filters, count);
+        up_scale_packed_columns(classes, start, count, packed_ptr, block_first_pixel, scale_up_factor, bits);
+    }
+    replicate_packed_row(packed_ptr, block_first_pixel, (size_t)num_columns * scale_up_factor, scale_up_factor - 1, bits);
+}
+
+// argmax_up_scale_mt writing a packed mask, work items are the fewest source rows whose output block ends on a byte
+template <typename T>
+void argmax_up_scale_packed_mt(
+    const T* const tensor_ptr,
+    uint8_t* const packed_ptr,
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor,
+    const unsigned int bits,
+    obj_detect::Thread_Pool& thread_pool)
+{
+    PROBE_SCOPE("argmax_up_scale_packed_mt");
+    const size_t tensor_row_size = (size_t)num_columns * num_filters;
+    const size_t scaled_up_row_block_size = (size_t)num_columns * scale_up_factor * scale_up_factor;
+    const unsigned int rows_per_item = packed_row_grain(scaled_up_row_block_size, bits);
+    const unsigned int num_items = (num_rows + rows_per_item - 1) / rows_per_item;
+    thread_pool.parallel_for(0, num_items, 1, [=](const unsigned int begin, const unsigned int end){
+        const unsigned int last_row = end * rows_per_item < num_rows ? end * rows_per_item : num_rows;
+        for(unsigned int r=begin * rows_per_item; r<last_row; r++)
+        {
+            argmax_up_scale_packed_row(
+                tensor_ptr + r * tensor_row_size, packed_ptr, r * scaled_up_row_block_size,
+                num_columns, num_filters, scale_up_factor, bits);
+        }
+    }, obj_detect::Partition::dynamic);
+}
+
+// nearest-neighbour upsample of one source row of a packed mask into its packed output block
+inline void upsampler_packed_row(
+    const uint8_t* const packed_ptr,
+    const size_t first_pixel,
+    uint8_t* const scaled_up_packed_ptr,
+    const size_t block_first_pixel,
+    const unsigned int num_columns,
+    const unsigned int scale_up_factor,
+    const unsigned int bits)
+{
+    const unsigned int block_size = 256;
+    uint8_t classes[block_size];
+    for(unsigned int start=0; start<num_columns; start+=block_size)
+    {
+        const unsigned int count = (num_columns - start < block_size) ? num_columns - start : block_size;
+        unpack_mask(packed_ptr, classes, first_pixel + start, count, bits);
+        up_scale_packed_columns(classes, start, count, scaled_up_packed_ptr, block_first_pixel, scale_up_factor, bits);
+    }
+    replicate_packed_row(scaled_up_packed_ptr, block_first_pixel, (size_t)num_columns * scale_up_factor, scale_up_factor - 1, bits);
+}
+
+// upsampler for a single packed mask, the same integer scale on both axes
+inline void upsampler_packed(
+    const uint8_t* const packed_ptr,
+    uint8_t* const scaled_up_packed_ptr,
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int scale_up_factor,
+    const unsigned int bits)
+{
+    const size_t scaled_up_row_block_size = (size_t)num_columns * scale_up_factor * scale_up_factor;
+    for(unsigned int r=0; r<num_rows; r++)
+    {
+        upsampler_packed_row(packed_ptr, (size_t)r * num_columns, scaled_up_packed_ptr, r * scaled_up_row_block_size, num_columns, scale_up_factor, bits);
+    }
+}
+
+inline void upsampler_packed_mt(
+    const uint8_t* const packed_ptr,
+    uint8_t* const scaled_up_packed_ptr,
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int scale_up_factor,
+    const unsigned int bits,
+    obj_detect::Thread_Pool& thread_pool)
+{
+    PROBE_SCOPE("upsampler_packed_mt");
+    const size_t scaled_up_row_block_size = (size_t)num_columns * scale_up_factor * scale_up_factor;
+    const unsigned int rows_per_item = packed_row_grain(scaled_up_row_block_size, bits);
+    const unsigned int num_items = (num_rows + rows_per_item - 1) / rows_per_item;
+    thread_pool.parallel_for(0, num_items, 1, [=](const unsigned int begin, const unsigned int end){
+        const unsigned int last_row = end * rows_per_item < num_rows ? end * rows_per_item : num_rows;
+        for(unsigned int r=begin * rows_per_item; r<last_row; r++)
+        {
+            upsampler_packed_row(packed_ptr, (size_t)r * num_columns, scaled_up_packed_ptr, r * scaled_up_row_block_size, num_columns, scale_up_factor, bits);
+        }
+    }, obj_detect::Partition::dynamic);
+}
+
+// argmax_tensor_mt with the optional value and margin planes of argmax_top2_tensor, int8 blocks go through the SIMD kernel
+template <typename T, typename I, typename M>
+void argmax_top2_tensor_mt(
+    const T* tensor_ptr,
+    I* const mat_ptr,
+    T* const value_ptr,
+    M* const margin_ptr,
+    const unsigned int num_filters,
+    const unsigned int mat_size,
+    obj_detect::Thread_Pool& thread_pool,
+    const obj_detect::Partition partition = obj_detect::Partition::static_chunks,
+    const unsigned int grain = 1)
+{
+    PROBE_SCOPE("argmax_top2_tensor_mt");
+    thread_pool.parallel_for(0, mat_size, grain, [=](const unsigned int begin, const unsigned int end){
+        argmax_top2_row(
+            tensor_ptr + (size_t)num_filters * begin,
+            mat_ptr + begin,
+            value_ptr ? value_ptr + begin : nullptr,
+            margin_ptr ? margin_ptr + begin : nullptr,
+            num_filters,
+            end - begin);
+    }, partition);
+}
+
+// argmax_up_scale_row with the value and margin planes upsampled alongside the class map, each present plane
+// uses the last of its own output rows as scratch
+template <typename T, typename I, typename M>
+inline void argmax_top2_up_scale_row(
+    const T* const tensor_row_ptr,
+    I* const scaled_up_row_ptr,
+    T* const scaled_up_value_row_ptr,
+    M* const scaled_up_margin_row_ptr,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor)
+{
+    const size_t scratch_offset = scale_up_factor < 2 ? 0 : (size_t)(scale_up_factor - 1) * num_columns * scale_up_factor;
+    argmax_top2_row(
+        tensor_row_ptr,
+        scaled_up_row_ptr + scratch_offset,
+        scaled_up_value_row_ptr ? scaled_up_value_row_ptr + scratch_offset : nullptr,
+        scaled_up_margin_row_ptr ? scaled_up_margin_row_ptr + scratch_offset : nullptr,
+        num_filters,
+        num_columns);
+    if(scale_up_factor < 2) return;
+    up_scale_row_block(scaled_up_row_ptr, num_columns, scale_up_factor);
+    if(scaled_up_value_row_ptr) up_scale_row_block(scaled_up_value_row_ptr, num_columns, scale_up_factor);
+    if(scaled_up_margin_row_ptr) up_scale_row_block(scaled_up_margin_row_ptr, num_columns, scale_up_factor);
+}
+
+// argmax_up_scale_batch_mt that also upsamples the optional value and margin planes, either may be null
+template <typename T, typename I, typename M>
+void argmax_top2_up_scale_batch_mt(
+    const T* const tensor_ptr,
+    I* const scaled_up_mat_ptr,
+    T* const scaled_up_value_ptr,
+    M* const scaled_up_margin_ptr,
+    const unsigned int num_frames,
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor,
+    obj_detect::Thread_Pool& thread_pool)
+{
+    PROBE_SCOPE("argmax_top2_up_scale_batch_mt");
+    const unsigned int tensor_row_size = num_columns * num_filters;
+    const unsigned int scaled_up_row_block_size = num_columns * scale_up_factor * scale_up_factor;
+    thread_pool.parallel_for(0, num_frames * num_rows, 1, [=](const unsigned int begin, const unsigned int end){
+        for(unsigned int r=begin; r<end; r++)
+        {
+            const size_t offset = (size_t)r * scaled_up_row_block_size;
+            argmax_top2_up_scale_row(
+                tensor_ptr + (size_t)r * tensor_row_size,
+                scaled_up_mat_ptr + offset,
+                scaled_up_value_ptr ? scaled_up_value_ptr + offset : nullptr,
+                scaled_up_margin_ptr ? scaled_up_margin_ptr + offset : nullptr,
+                num_columns,
+                num_filters,
+                scale_up_factor);
+        }
+    }, obj_detect::Partition::dynamic);
+}
+
+template <typename T, typename I, typename M>
+void argmax_top2_up_scale_mt(
+    const T* const tensor_ptr,
+    I* const scaled_up_mat_ptr,
+    T* const scaled_up_value_ptr,
+    M* const scaled_up_margin_ptr,
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int num_filters,
+    const unsigned int scale_up_factor,
+    obj_detect::Thread_Pool& thread_pool)
+{
+    argmax_top2_up_scale_batch_mt(
+        tensor_ptr, scaled_up_mat_ptr, scaled_up_value_ptr, scaled_up_margin_ptr, 1,
+        num_rows, num_columns, num_filters, scale_up_factor, thread_pool);
+}
+
+// nearest-neighbour index tables from a (num_rows, num_columns) source to any target size,
+// built once and reused by upsampler_mt for every frame
+struct Upsample_Plan
+{
+    unsigned int num_rows = 0;
+    unsigned int num_columns = 0;
+    unsigned int scaled_up_num_rows = 0;
+    unsigned int scaled_up_num_columns = 0;
+    unsigned int scale_x = 0;                   // integer horizontal factor, 0 when the width ratio is not an integer
+    std::vector<unsigned int> row_begin;        // first output row of every source row, num_rows + 1 entries
+    std::vector<unsigned int> column_index;     // source column of every output column
+    std::vector<int8_t> column_shuffle;         // column_index relative to the first column of its 16 wide block
+    bool shuffle_ok = false;                    // every column_shuffle entry fits a 16 byte window
+};
+
+inline Upsample_Plan make_upsample_plan(
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_rows,
+    const unsigned int scaled_up_num_columns)
+{
+    Upsample_Plan plan;
+    plan.num_rows = num_rows;
+    plan.num_columns = num_columns;
+    plan.scaled_up_num_rows = scaled_up_num_rows;
+    plan.scaled_up_num_columns = scaled_up_num_columns;
+    plan.scale_x = (num_columns > 0 && scaled_up_num_columns % num_columns == 0) ? scaled_up_num_columns / num_columns : 0;
+
+    // output coordinate y maps to source floor(y * num_rows / scaled_up_num_rows), the same rule as upsampler()
+    plan.row_begin.assign(num_rows + 1, scaled_up_num_rows);
+    for(unsigned int y=scaled_up_num_rows; y-- > 0;)
+    {
+        plan.row_begin[(unsigned int)((unsigned long long)y * num_rows / scaled_up_num_rows)] = y;
+    }
+    for(unsigned int r=num_rows; r-- > 0;)
+    {
+        if(plan.row_begin[r] > plan.row_begin[r + 1]) plan.row_begin[r] = plan.row_begin[r + 1];
+    }
+
+    plan.column_index.resize(scaled_up_num_columns);
+    plan.column_shuffle.resize(scaled_up_num_columns);
+    plan.shuffle_ok = true;
+    for(unsigned int c=0; c<scaled_up_num_columns; c++)
+    {
+        plan.column_index[c] = (unsigned int)((unsigned long long)c * num_columns / scaled_up_num_columns);
+        const unsigned int offset = plan.column_index[c] - plan.column_index[c & ~15u];
+        plan.shuffle_ok = plan.shuffle_ok && offset < 16;
+        plan.column_shuffle[c] = (int8_t)(offset < 16 ? offset : 0);
+    }
+    return plan;
+}
+
+inline Upsample_Plan make_upsample_plan_scaled(
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int scale_up_factor_y,
+    const unsigned int scale_up_factor_x)
+{
+    return make_upsample_plan(num_rows, num_columns, num_rows * scale_up_factor_y, num_columns * scale_up_factor_x);
+}
+
+// fills the first output row of a source row, int8 masks take the vectorized broadcast paths
+template <typename T>
+inline void upsample_columns(const T* const src_row_ptr, T* const dst_row_ptr, const Upsample_Plan& plan, const unsigned int num_filters)
+{
+    T* dst_cptr = dst_row_ptr;
+    if(num_filters == 1)
+    {
+        for(unsigned int c=0; c<plan.scaled_up_num_columns; c++) dst_cptr[c] = src_row_ptr[plan.column_index[c]];
+        return;
+    }
+    for(unsigned int c=0; c<plan.scaled_up_num_columns; c++)
+    {
+        memcpy(dst_cptr, src_row_ptr + plan.column_index[c] * num_filters, sizeof(T) * num_filters);
+        dst_cptr += num_filters;
+    }
+}
+
+inline void upsample_columns(const int8_t* const src_row_ptr, int8_t* const dst_row_ptr, const Upsample_Plan& plan, const unsigned int num_filters)
+{
+    if(num_filters == 1 && plan.scale_x > 0 && plan.scale_x <= 16 && 16 % plan.scale_x == 0)
+    {
+        broadcast_bytes_simd(src_row_ptr, dst_row_ptr, plan.num_columns, plan.scale_x);
+    }
+    else if(num_filters == 1 && plan.shuffle_ok)
+    {
+        gather_bytes_simd(src_row_ptr, plan.num_columns, dst_row_ptr, plan.scaled_up_num_columns, plan.column_index.data(), plan.column_shuffle.data());
+    }
+    else
+    {
+        upsample_columns<int8_t>(src_row_ptr, dst_row_ptr, plan, num_filters);
+    }
+}
+
+// upsamples one source row, the first of its output rows is built from the column table
+// and the duplicated rows below it are memcpy'd, as in upsampler()
+template <typename T>
+inline void upsample_row(
+    const T* const tensor_ptr,
+    T* const scaled_up_tensor_ptr,
+    const Upsample_Plan& plan,
+    const unsigned int num_filters,
+    const unsigned int r)
+{
+    const unsigned int first_row = plan.row_begin[r];
+    const unsigned int end_row = plan.row_begin[r + 1];
+    if(first_row == end_row) return;
+    const size_t scaled_up_row_size = (size_t)plan.scaled_up_num_columns * num_filters;
+    T* const dst_cptr = scaled_up_tensor_ptr + first_row * scaled_up_row_size;
+    upsample_columns(tensor_ptr + (size_t)r * plan.num_columns * num_filters, dst_cptr, plan, num_filters);
+    for(unsigned int y=1; y<end_row-first_row; y++)
+    {
+        memcpy(dst_cptr + y * scaled_up_row_size, dst_cptr, sizeof(T) * scaled_up_row_size);
+    }
+}
+
+// row-parallel nearest-neighbour upsampler of num_frames frames stored back to back,
+// (frame, source row) items share one parallel_for
+template <typename T>
+void upsampler_batch_mt(
+    const T* const tensor_ptr,
+    T* const scaled_up_tensor_ptr,
+    const unsigned int num_frames,
+    const Upsample_Plan& plan,
+    const unsigned int num_filters,
+    obj_detect::Thread_Pool& thread_pool)
+{
+    PROBE_SCOPE("upsampler_batch_mt");
+    const size_t frame_size = (size_t)plan.num_rows * plan.num_columns * num_filters;
+    const size_t scaled_up_frame_size = (size_t)plan.scaled_up_num_rows * plan.scaled_up_num_columns * num_filters;
+    const unsigned int num_rows = plan.num_rows;
+    thread_pool.parallel_for(0, num_frames * num_rows, 1, [=, &plan](const unsigned int begin, const unsigned int end){
+        for(unsigned int i=begin; i<end; i++)
+        {
+            const unsigned int n = i / num_rows;
+            upsample_row(tensor_ptr + n * frame_size, scaled_up_tensor_ptr + n * scaled_up_frame_size, plan, num_filters, i - n * num_rows);
+        }
+    }, obj_detect::Partition::dynamic);
+}
+
+// row-parallel nearest-neighbour upsampler for separate x/y factors and arbitrary target sizes
+template <typename T>
+void upsampler_mt(
+    const T* const tensor_ptr,
+    T* const scaled_up_tensor_ptr,
+    const Upsample_Plan& plan,
+    const unsigned int num_filters,
+    obj_detect::Thread_Pool& thread_pool)
+{
+    upsampler_batch_mt(tensor_ptr, scaled_up_tensor_ptr, 1, plan, num_filters, thread_pool);
+}
+
+// half-pixel bilinear sampling tables (the align_corners=false convention) from a (num_rows, num_columns) source
+// to any target size. weights are Q4, so the four-tap blend of an int8 logit stays exact in int16,
+// and power-of-two factors up to 8 have no rounding at all
+struct Bilinear_Plan
+{
+    unsigned int num_rows = 0;
+    unsigned int num_columns = 0;
+    unsigned int scaled_up_num_rows = 0;
+    unsigned int scaled_up_num_columns = 0;
+    std::vector<unsigned int> row_index;        // upper source row of every output row
+    std::vector<uint8_t> row_weight;            // Q4 weight of the row below it
+    std::vector<unsigned int> column_index;     // left source column of every output column
+    std::vector<uint8_t> column_weight;         // Q4 weight of the column right of it
+};
+
+// source coordinate (dst + 0.5) * src_size / dst_size - 0.5, clamped to the edges and rounded to 1/16
+inline void bilinear_sample(const unsigned int dst, const unsigned int src_size, const unsigned int dst_size, unsigned int& index, uint8_t& weight)
+{
+    const long long numerator = (2LL * dst + 1) * src_size - dst_size;
+    const long long denominator = 2LL * dst_size;
+    index = 0;
+    weight = 0;
+    if(numerator <= 0) return;
+    index = (unsigned int)(numerator / denominator);
+    unsigned int q4 = (unsigned int)(((numerator % denominator) * 16 + dst_size) / denominator);
+    if(q4 == 16)
+    {
+        index++;
+        q4 = 0;
+    }
+    if(index + 1 >= src_size)
+    {
+        index = src_size - 1;
+        q4 = 0;
+    }
+    weight = (uint8_t)q4;
+}
+
+inline Bilinear_Plan make_bilinear_plan(
+    const unsigned int num_rows,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_rows,
+    const unsigned int scaled_up_num_columns)
+{
+    Bilinear_Plan plan;
+    plan.num_rows = num_rows;
+    plan.num_columns = num_columns;
+    plan.scaled_up_num_rows = scaled_up_num_rows;
+    plan.scaled_up_num_columns = scaled_up_num_columns;
+    plan.row_index.resize(scaled_up_num_rows);
+    plan.row_weight.resize(scaled_up_num_rows);
+    for(unsigned int y=0; y<scaled_up_num_rows; y++) bilinear_sample(y, num_rows, scaled_up_num_rows, plan.row_index[y], plan.row_weight[y]);
+    plan.column_index.resize(scaled_up_num_columns);
+    plan.column_weight.resize(scaled_up_num_columns);
+    for(unsigned int x=0; x<scaled_up_num_columns; x++) bilinear_sample(x, num_columns, scaled_up_num_columns, plan.column_index[x], plan.column_weight[x]);
+    return plan;
+}
+
+// scalar reference of bilinear_argmax_row_simd, the argmax of the blended logits of every output column
+template <typename T, typename I>
+inline void bilinear_argmax_row(
+    const T* const row0_ptr,
+    const T* const row1_ptr,
+    const unsigned int row_weight,
+    I* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* const column_index,
+    const uint8_t* const column_weight)
+{
+    (void)num_columns;
+    const int w_y1 = (int)row_weight;
+    const int w_y0 = 16 - w_y1;
+    for(unsigned int c=0; c<scaled_up_num_columns; c++)
+    {
+        const unsigned int offset_0 = column_index[c] * num_filters;
+        const unsigned int offset_1 = offset_0 + (column_weight[c] > 0 ? num_filters : 0);
+        const int w_x1 = (int)column_weight[c];
+        const int w_x0 = 16 - w_x1;
+        unsigned int max_index = 0;
+        int max_value = 0;
+        for(unsigned int f=0; f<num_filters; f++)
+        {
+            const int value =
+                w_x0 * (w_y0 * (int)row0_ptr[offset_0 + f] + w_y1 * (int)row1_ptr[offset_0 + f]) +
+                w_x1 * (w_y0 * (int)row0_ptr[offset_1 + f] + w_y1 * (int)row1_ptr[offset_1 + f]);
+            if(f == 0 || value > max_value)
+            {
+                max_value = value;
+                max_index = f;
+            }
+        }
+        mat_row_ptr[c] = (I)max_index;
+    }
+}
+
+inline void bilinear_argmax_row(
+    const int8_t* const row0_ptr,
+    const int8_t* const row1_ptr,
+    const unsigned int row_weight,
+    int8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* const column_index,
+    const uint8_t* const column_weight)
+{
+    bilinear_argmax_row_simd(row0_ptr, row1_ptr, row_weight, mat_row_ptr, num_filters, num_columns, scaled_up_num_columns, column_index, column_weight);
+}
+
+inline void bilinear_argmax_row(
+    const int8_t* const row0_ptr,
+    const int8_t* const row1_ptr,
+    const unsigned int row_weight,
+    uint8_t* const mat_row_ptr,
+    const unsigned int num_filters,
+    const unsigned int num_columns,
+    const unsigned int scaled_up_num_columns,
+    const unsigned int* const column_index,
+    const uint8_t* const column_weight)
+{
+    bilinear_argmax_row_simd(row0_ptr, row1_ptr, row_weight, mat_row_ptr, num_filters, num_columns, scaled_up_num_columns, column_index, column_weight);
+}
+
+// fused bilinear logit upsample + argmax of num_frames frames stored back to back,
+// (frame, block of output rows) items are claimed dynamically behind a single barrier
+template <typename T, typename I>
+void bilinear_argmax_batch_mt(
+    const T* const tensor_ptr,
+    I* const scaled_up_mat_ptr,
+    const unsigned int num_frames,
+    const Bilinear_Plan& plan,
+    const unsigned int num_filters,
+    obj_detect::Thread_Pool& thread_pool)
+{
+    PROBE_SCOPE("bilinear_argmax_batch_mt");
+    const unsigned int tensor_row_size = plan.num_columns * num_filters;
+    const size_t frame_size = (size_t)plan.num_rows * tensor_row_size;
+    const size_t scaled_up_mat_size = (size_t)plan.scaled_up_num_rows * plan.scaled_up_num_columns;
+    const unsigned int scaled_up_num_rows = plan.scaled_up_num_rows;
+    thread_pool.parallel_for(0, num_frames * scaled_up_num_rows, 4, [=, &plan](const unsigned int begin, const unsigned int end){
+        for(unsigned int i=begin; i<end; i++)
+        {
+            const unsigned int n = i / scaled_up_num_rows;
+            const unsigned int y = i - n * scaled_up_num_rows;
+            const T* const row0_ptr = tensor_ptr + n * frame_size + plan.row_index[y] * tensor_row_size;
+            const T* const row1_ptr = plan.row_weight[y] > 0 ? row0_ptr + tensor_row_size : row0_ptr;
+            bilinear_argmax_row(
+                row0_ptr,
+                row1_ptr,
+                plan.row_weight[y],
+                scaled_up_mat_ptr + n * scaled_up_mat_size + y * plan.scaled_up_num_columns,
+                num_filters,
+                plan.num_columns,
+                plan.scaled_up_num_columns,
+                plan.column_index.data(),
+                plan.column_weight.data());
+        }
+    }, obj_detect::Partition::dynamic);
+}
+
+// fused bilinear logit upsample + argmax, output rows are claimed dynamically and the upsampled logits are never stored
+template <typename T, typename I>
+void bilinear_argmax_mt(
+    const T* const tensor_ptr,
+    I* const scaled_up_mat_ptr,
+    const Bilinear_Plan& plan,
+    const unsigned int num_filters,
+    obj_detect::Thread_Pool& thread_pool)
+{
+    bilinear_argmax_batch_mt(tensor_ptr, scaled_up_mat_ptr, 1, plan, num_filters, thread_pool);
+}
+
+// affine int8 quantization of the logits, real = scale * (q - zero_point). one entry in each vector is a per-tensor
+// quantization, num_filters entries a per-channel one
+struct Quant_Params
+{
+    std::vector<float> scale;
+    std::vector<int32_t> zero_point;
+};
+
+// the per-channel dequantization folded into int32 keys, key[f] = multiplier[f] * q + offset[f] = multiplier[f] * (q - zero_point[f]).
+// multiplier[f] is scale[f] in a fixed-point unit picked so every key of an int8 logit fits in int32 with room to spare,
+// which keeps about 23 bits of relative precision, so the classes only differ from a float dequantize + argmax
+// when their real logits are within about 1e-7 of each other. the tables are padded to a multiple of 8 with
+// multiplier 0 and offset INT32_MIN, a key no real logit reaches, so the SIMD kernels never need a lane mask
+struct Quant_Plan
+{
+    unsigned int num_filters = 0;
+    bool uniform = false;                   // one positive scale and one zero-point, the raw int8 order is the real order
+    std::vector<int32_t> multiplier;
+    std::vector<int32_t> offset;
+};
+
+// false when scale or zero_point holds neither 0, 1 nor num_filters entries, plan is left untouched then
+inline bool make_quant_plan(const Quant_Params& params, const unsigned int num_filters, Quant_Plan& plan)
+{
+    const size_t num_scales = params.scale.size();
+    const size_t num_zero_points = params.zero_point.size();
+    if((num_scales > 1 && num_scales != num_filters) || (num_zero_points > 1 && num_zero_points != num_filters))
+    {
+        std::cerr<<"Quantization params : "<< num_scales<<" scales and "<< num_zero_points<<" zero-points for "<< num_filters<<" classes\n";
+        return false;
+    }
+    plan.num_filters = num_filters;
+    auto scale = [&](const unsigned int f){ return num_scales == 0 ? 1.0 : (double)params.scale[num_scales == 1 ? 0 : f]; };
+    auto zero_point = [&](const unsigned int f){ return num_zero_points == 0 ? 0 : params.zero_point[num_zero_points == 1 ? 0 : f]; };
+
+    plan.uniform = true;
+    double max_scale = 0.0;
+    for(unsigned int f=0; f<num_filters; f++)
+    {
+        plan.uniform = plan.uniform && scale(f) == scale(0) && zero_point(f) == zero_point(0) && scale(f) > 0.0;
+        max_scale = std::max(max_scale, std::fabs(scale(f)));
+    }
+
+    // the largest |scale * (q - zero_point)| over every class and every int8 q sets the unit
+    double bound = 0.0;
+    for(unsigned int f=0; f<num_filters; f++)
+    {
+        const double range = (double)std::max<int64_t>((int64_t)INT8_MAX - zero_point(f), (int64_t)zero_point(f) - INT8_MIN);
+        bound = std::max(bound, std::fabs(scale(f)) / (max_scale > 0.0 ? max_scale : 1.0) * range);
+    }
+    const double unit = bound > 0.0 ? (double)(INT32_MAX - 1024) / bound : 0.0;
+
+    const unsigned int padded_num_filters = (num_filters + 7) & ~7u;
+    plan.multiplier.assign(padded_num_filters, 0);
+    plan.offset.assign(padded_num_filters, INT32_MIN);
+    for(unsigned int f=0; f<num_filters; f++)
+    {
+        const double normalized = max_scale > 0.0 ? scale(f) / max_scale : 0.0;
+        plan.multiplier[f] = (int32_t)std::floor(normalized * unit + 0.5);
+        plan.offset[f] = (int32_t)(-(int64_t)plan.multiplier[f] * zero_point(f));
+    }
+    return true;
+}
+
+// argmax over the dequantization keys of int8 cells, the first index wins on ties.
+// multiplier and offset are the padded Quant_Plan tables
+template <typename I>
+inline void argmax_quantized_tensor(
+    const int8_t* tensor_ptr,
+    I* const mat_ptr,
+    const int32_t* const multiplier,
+    const int32_t* const offset,
+    const unsigned int num_filters,
+    const unsigned int mat_size)
+{
+    for(unsigned int i=0; i<mat_size; i++)
+    {
+        int32_t max_key = INT32_MIN;
+        unsigned int max_index = 0;
+        for(unsigned int f=0; f<num_filters; f++)
+        {
+            // wraps through uint32, the final key is in range even when the product and the offset are not
+            const int32_t key = (int32_t)((uint32_t)multiplier[f] * (uint32_t)(int32_t)tensor_ptr[f] + (uint32_t)offset[f]);
+            if(key > max_key || f == 0)
+            {
+                max_key = key;
+                max_index = f;
+            }
+        }
+        mat_ptr[i] = (I)max_index;
+        tensor_ptr += num_filters;
+    }
+}
+
+// uniform quantization keeps the raw comparison of argmax_tensor
+template <typename I>
+inline void argmax_quantized_tensor(const int8_t* tensor_ptr, I* const mat_ptr, const Quant_Plan& plan, const unsigned int mat_size)
+{
+    if(plan.uniform) argmax_tensor(tensor_ptr, mat_ptr, plan.num_filters, mat_size);
+    else argmax_quantized_tensor(tensor_ptr, mat_ptr, plan.multiplier.data(), plan.offset.data(), plan.num_filters, mat_size);
+}
+
+// row helper of argmax_quantized_tensor_mt, int8 and uint8 indices go through the SIMD kernels
+template <typename I>
+inline void argmax_quantized_row(const int8_t* tensor_ptr, I* const mat_ptr, const Quant_Plan& plan, const unsigned int num_columns)
+{
+    argmax_quantized_tensor(tensor_ptr, mat_ptr, plan, num_columns);
+}
+
+inline void argmax_quantized_row(const int8_t* tensor_ptr, int8_t* const mat_ptr, const Quant_Plan& plan, const unsigned int num_columns)
+{
+    if(plan.uniform) argmax_row(tensor_ptr, mat_ptr, plan.num_filters, num_columns);
+    else argmax_quantized_simd(tensor_ptr, mat_ptr, plan.multiplier.data(), plan.offset.data(), plan.num_filters, num_columns);
+}
+
+inline void argmax_quantized_row(const int8_t* tensor_ptr, uint8_t* const mat_ptr, const Quant_Plan& plan, const unsigned int num_columns)
+{
+    if(plan.uniform) argmax_row(tensor_ptr, mat_ptr, plan.num_filters, num_columns);
+    else argmax_quantized_simd(tensor_ptr, mat_ptr, plan.multiplier.data(), plan.offset.data(), plan.num_filters, num_columns);
+}
+
+// quantization-aware argmax_tensor_mt, the plan is shared read-only by the workers
+template <typename I>
+void argmax_quantized_tensor_mt(
+    const int8_t* const tensor_ptr,
+    I* const mat_ptr,
+    const Quant_Plan& plan,
+    const unsigned int mat_size,
+    obj_detect::Thread_Pool& thread_pool,
+    const obj_detect::Partition partition = obj_detect::Partition::static_chunks,
+    const unsigned int grain = 1)
+{
+    PROBE_SCOPE("argmax_quantized_tensor_mt");
+    const Quant_Plan* const plan_ptr = &plan;
+    thread_pool.parallel_for(0, mat_size, grain, [=](const unsigned int begin, const unsigned int end){
+        argmax_quantized_row(tensor_ptr + (size_t)plan_ptr->num_filters * begin, mat_ptr + begin, *plan_ptr, end - begin);
+    }, partition);
+}
@@ -4,10 +4,12 @@
 #include <iomanip>
 #include <vector>
 #include <string>
-#include <regex>
 #include <fstream>
 #include <sstream>
 
+#include "Tensor_File.hpp"
+#include "Packed_Mask.hpp"
+
 template<typename T>
 void print_tensor(
     const T* const tensor_ptr,
@@ -54,6 +56,23 @@ void comp_vec(const std::vector<T> vec_1, const std::vector<T> vec_2)
     }
 }
 
+// comp_vec for a packed mask against the mask it should hold
+template <typename I>
+void comp_packed_mask(const std::vector<uint8_t>& packed, const unsigned int bits, const std::vector<I>& mask)
+{
+    if(packed.size() < packed_mask_size(mask.size(), bits))
+    {
+        std::cerr<<"size mismatch\n";
+        return;
+    }
+
+    const size_t pixel = packed_mask_mismatch(packed.data(), mask.data(), mask.size(), bits);
+    if(pixel != mask.size())
+    {
+        std::cerr<<"value mismatch : "<< packed_mask_get(packed.data(), pixel, bits)<< " != " << (int)mask[pixel] <<std::endl;
+    }
+}
+
 void fill_vec(std::vector<int8_t>& vec)
 {
     for(auto& item : vec)
@@ -62,62 +81,47 @@ void fill_vec(std::vector<int8_t>& vec)
     }
 }
 
-std::vector<int> array_dimensions(std::vector<std::string> line_array) 
+// reads every frame of the dump, the header shape is (batch, height, width, channel, ...).
+// vec is replaced, false (with vec left empty) if the file is missing or does not match its header shape
+bool vector_populator(
+    const std::string name,
+    std::vector<int8_t>& vec,
+    unsigned int& batch,
+    unsigned int& width,
+    unsigned int& height,
+    unsigned int& channel,
+    obj_detect::Thread_Pool* thread_pool = nullptr) 
 {
-    std::string s = line_array[0];
-    std::string delimiter_1 = "(";
-    std::string delimiter_2 = ")";
-    int str_start = s.find(delimiter_1) + 1;
-    int str_end = s.find(delimiter_2) - str_start;
-    std::string token = s.substr(str_start, str_end);
-    token = std::regex_replace(token, std::regex(","), "");
+    std::vector<uint32_t> shape;
+    if (!parse_text_dump(name, vec, shape, thread_pool)) return false;
 
-    std::vector<int> arr;
-    std::stringstream sstream(token);
-    int temp;
-    while (sstream >> temp)
-        arr.push_back(temp);
-
-    return arr;
+    batch = shape[0];
+    height = shape.size() > 1 ? shape[1] : 1;
+    width = shape.size() > 2 ? shape[2] : 1;
+    channel = shape.size() > 3 ? shape[3] : 1;
+    return true;
 }
 
-void vector_populator(
+bool vector_populator(
     const std::string name,
     std::vector<int8_t>& vec,
     unsigned int& width,
     unsigned int& height,
-    unsigned int& channel) 
+    unsigned int& channel,
+    obj_detect::Thread_Pool* thread_pool = nullptr) 
 {
+    unsigned int batch = 0;
+    return vector_populator(name, vec, batch, width, height, channel, thread_pool);
+}
 
-    std::vector<std::string> arr;
-    std::vector<int> dim_array;
-
-    std::ifstream file(name);
-    if (!file.is_open())
-    {
-        std::cerr << "File not opened..\n";
-        exit(1);
-    }
-
-    std::string str;
-    while (getline(file, str))
-    {
-        arr.push_back(str);
-    }
-
-    dim_array = array_dimensions(arr);
-
-    width = dim_array[2];
-    height = dim_array[1];
-    channel = dim_array[3];
-
-    int count = 1;
-    for (unsigned int i = 0; i < height; i++) {
-        for (unsigned int j = 0; j < width; j++) {
-            for (unsigned int k = 0; k < channel; k++) {
-                vec.push_back(std::stof(arr[count]));
-                count++;
-            }
-        }
-    }
+// one-shot conversion of a text dump to a tensor file, stored as int8 (batch, height, width, channel)
+bool convert_text_dump(const std::string& text_path, const std::string& tensor_path)
+{
+    std::vector<int8_t> vec;
+    unsigned int batch = 0;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int channel = 0;
+    if (!vector_populator(text_path, vec, batch, width, height, channel)) return false;
+    return write_tensor_file(tensor_path, vec.data(), Tensor_Dtype::int8, {batch, height, width, channel});
 }
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+namespace obj_detect
+{
+    // fixed capacity Chase-Lev deque of task pointers.
+    // the owning worker pushes and pops at the bottom, any other thread steals from the top.
+    template <typename T>
+    class Work_Stealing_Deque
+    {
+    public:
+        Work_Stealing_Deque(const unsigned int capacity_log2 = 12) :
+            _top(0), _bottom(0), _mask(((int64_t)1 << capacity_log2) - 1), _buffer((size_t)1 << capacity_log2)
+        {
+            for (auto& slot : _buffer) slot.store(nullptr, std::memory_order_relaxed);
+        }
+
+        Work_Stealing_Deque(const Work_Stealing_Deque&) = delete;
+
+        // owner only, false when the deque is full
+        bool push(T* item)
+        {
+            const int64_t b = _bottom.load(std::memory_order_relaxed);
+            const int64_t t = _top.load(std::memory_order_acquire);
+            if (b - t > _mask) return false;
+            _buffer[b & _mask].store(item, std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_release);
+            return true;
+        }
+
+        // owner only, nullptr when empty
+        T* pop()
+        {
+            const int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+            _bottom.store(b, std::memory_order_seq_cst);
+            int64_t t = _top.load(std::memory_order_seq_cst);
+            if (t > b)
+            {
+                _bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            T* item = _buffer[b & _mask].load(std::memory_order_relaxed);
+            if (t == b)
+            {
+                // last item, race the thieves for it
+                if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) item = nullptr;
+                _bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        // any thread, nullptr when empty or when another thread won the race
+        T* steal()
+        {
+            int64_t t = _top.load(std::memory_order_seq_cst);
+            const int64_t b = _bottom.load(std::memory_order_seq_cst);
+            if (t >= b) return nullptr;
+            T* item = _buffer[t & _mask].load(std::memory_order_relaxed);
+            if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+            return item;
+        }
+
+        bool empty() const
+        {
+            return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+        }
+
+    private:
+        alignas(64) std::atomic<int64_t> _top;
+        alignas(64) std::atomic<int64_t> _bottom;
+        const int64_t _mask;
+        std::vector<std::atomic<T*>> _buffer;
+    };
+}
@@ -2,8 +2,40 @@
 
 int main()
 {
+    test_perf_counters();
     test();
     test_argmax_mt();
+    test_argmax_simd();
+    test_argmax_top2();
+    test_argmax_quantized();
+    test_packed_mask();
+    test_connected_components();
+    test_argmax_planar();
+    idle_policy_benchmark(200, 2);
+    test_work_stealing();
+    test_task_group();
+    test_parallel_for();
+    test_zero_alloc_frame();
+    test_upsampler_mt();
+    test_bilinear_argmax();
+    test_batch();
+    batch_benchmark(20, time(NULL));
+    test_pipeline();
+    pipeline_benchmark(2000, 8);
+    test_tensor_file();
+    test_text_dump();
+    sim_model_outputs();
+    test_fast_timer();
+    test_latency_histogram();
+    test_probe();
+    test_trace_export();
+    fast_timer_benchmark(1000000, time(NULL));
+    tensor_load_benchmark(FCN224_DATA_DIR, 5);
+
+    scheduler_benchmark(2048, 20, time(NULL));
+    counter_benchmark(200, time(NULL));
+    Timer::Get().print_duration();
+    Timer::Get().reset();
 
     return 0;
 }
\ No newline at end of file